@@ -0,0 +1,146 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPFW_BASE_INCLUDE_BLOCKPOOL_HPP_
+#define CPFW_BASE_INCLUDE_BLOCKPOOL_HPP_
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace cpfw {
+
+/**
+ * @brief free lists of fixed size blocks.
+ * each thread caches up to 2 batches, the rest go to a shared depot a batch at a time,
+ * so a block freed by a consumer thread comes back to the producer with one lock per
+ * BATCH blocks.
+ */
+template<std::size_t BLOCK_SIZE>
+class BlockPool {
+ public:
+    static constexpr std::size_t BATCH = 64U;
+    static constexpr std::size_t MAX_DEPOT_BATCHES = 64U;
+
+    static void* allocate() {
+        std::vector<void*> &blocks = tCache.blocks;
+        if (blocks.empty() && !depot().take(blocks)) {
+            return ::operator new(BLOCK_SIZE);
+        }
+        void *block = blocks.back();
+        blocks.pop_back();
+        return block;
+    }
+
+    static void deallocate(void *block) {
+        std::vector<void*> &blocks = tCache.blocks;
+        blocks.push_back(block);
+        if (blocks.size() >= 2 * BATCH) {
+            std::vector<void*> batch(blocks.end() - BATCH, blocks.end());
+            blocks.resize(blocks.size() - BATCH);
+            depot().give(std::move(batch));
+        }
+    }
+
+ private:
+    struct Depot {
+        bool take(std::vector<void*> &blocks) {
+            std::lock_guard<std::mutex> lock { mLock };
+            if (mBatches.empty()) {
+                return false;
+            }
+            blocks = std::move(mBatches.back());
+            mBatches.pop_back();
+            return true;
+        }
+
+        void give(std::vector<void*> &&batch) {
+            {
+                std::lock_guard<std::mutex> lock { mLock };
+                if (mBatches.size() < MAX_DEPOT_BATCHES) {
+                    mBatches.push_back(std::move(batch));
+                    return;
+                }
+            }
+            for (void *block : batch) {
+                ::operator delete(block);
+            }
+        }
+
+        std::mutex mLock;
+        std::vector<std::vector<void*>> mBatches;
+    };
+
+    struct Cache {
+        ~Cache() {
+            if (!blocks.empty()) {
+                depot().give(std::move(blocks));
+            }
+        }
+
+        std::vector<void*> blocks;
+    };
+
+    // leaked, thread caches may return blocks after static destruction
+    static Depot& depot() {
+        static Depot *sDepot = new Depot();
+        return *sDepot;
+    }
+
+    inline static thread_local Cache tCache;
+};
+
+/**
+ * @brief allocator of single objects from BlockPool, e.g. for the shared state of
+ * std::promise. arrays and over-aligned types go to operator new.
+ */
+template<typename T>
+class PoolAllocator {
+ public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {
+    }
+
+    T* allocate(std::size_t n) {
+        if (n == 1U && alignof(T) <= alignof(std::max_align_t)) {
+            return static_cast<T*>(BlockPool<sizeof(T)>::allocate());
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept {
+        if (n == 1U && alignof(T) <= alignof(std::max_align_t)) {
+            BlockPool<sizeof(T)>::deallocate(p);
+            return;
+        }
+        ::operator delete(p, std::align_val_t(alignof(T)));
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept {
+        return true;
+    }
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_BLOCKPOOL_HPP_
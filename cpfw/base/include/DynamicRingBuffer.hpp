@@ -0,0 +1,184 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPFW_BASE_INCLUDE_DYNAMICRINGBUFFER_HPP_
+#define CPFW_BASE_INCLUDE_DYNAMICRINGBUFFER_HPP_
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "MemoryUtils.h"
+#include "RingBuffer.hpp"
+
+namespace cpfw {
+
+/**
+ * @brief RingBuffer sized at runtime, for buffers too big for an object or for int32_t.
+ * capacity is a power of 2 so a position is masked into an index, positions are 64 bits
+ * and only grow. the memory is on the heap, or with hugePages in huge pages for multi-GB
+ * capture buffers, fewer TLB misses on a sweep, see mapHugePages.
+ * no lock in, as RingBuffer.
+ */
+template<typename T>
+class DynamicRingBuffer {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+ public:
+    /**
+     * @param capacity rounded up to a power of 2.
+     * @param hugePages for capacities of HUGE_PAGE_SIZE bytes and above, on the heap if
+     *     huge pages can not be mapped.
+     */
+    explicit DynamicRingBuffer(std::size_t capacity, bool hugePages = false)
+            : mCapacity(std::bit_ceil(std::max<std::size_t>(capacity, 1U))),
+              mMask(mCapacity - 1U) {
+        std::size_t bytes = mCapacity * sizeof(T);
+        void *data = nullptr;
+        // a power of 2 bytes from a huge page on is a multiple of it
+        if (hugePages && std::has_single_bit(bytes) && bytes >= HUGE_PAGE_SIZE
+                && 0 == mapHugePages(bytes, &data)) {
+            mData = static_cast<T*>(data);
+            mHugePages = true;
+        } else {
+            mData = new T[mCapacity];
+        }
+    }
+
+    ~DynamicRingBuffer() {
+        if (mHugePages) {
+            unmapHugePages(mData, mCapacity * sizeof(T));
+        } else {
+            delete[] mData;
+        }
+    }
+
+    DynamicRingBuffer(const DynamicRingBuffer&) = delete;
+    DynamicRingBuffer& operator=(const DynamicRingBuffer&) = delete;
+
+    int32_t write(const std::vector<T> &writeBuffer) {
+        return write(std::span<const T>(writeBuffer));
+    }
+
+    // all or nothing, -EAGAIN if idle size is not enough
+    int32_t write(std::span<const T> writeBuffer) {
+        if (writeBuffer.empty()) {
+            return 0;
+        }
+        if (writeBuffer.size() > getIdleSize()) {
+            return -EAGAIN;
+        }
+        RingBufferSpans<T> spans = spansAt(mTail, writeBuffer.size());
+        std::memcpy(spans.first.data(), writeBuffer.data(), spans.first.size_bytes());
+        std::memcpy(spans.second.data(), writeBuffer.data() + spans.first.size(),
+                spans.second.size_bytes());
+        mTail += writeBuffer.size();
+        return 0;
+    }
+
+    int32_t read(std::vector<T> &readBuffer, std::size_t readSize) {
+        readBuffer.resize(readSize);
+        return read(std::span<T>(readBuffer));
+    }
+
+    // all or nothing, -EAGAIN if available size is not enough
+    int32_t read(std::span<T> readBuffer) {
+        if (readBuffer.empty()) {
+            return 0;
+        }
+        if (readBuffer.size() > getAvailableSize()) {
+            return -EAGAIN;
+        }
+        RingBufferSpans<T> spans = spansAt(mHead, readBuffer.size());
+        std::memcpy(readBuffer.data(), spans.first.data(), spans.first.size_bytes());
+        std::memcpy(readBuffer.data() + spans.first.size(), spans.second.data(),
+                spans.second.size_bytes());
+        mHead += readBuffer.size();
+        return 0;
+    }
+
+    // as RingBuffer::acquireWrite
+    RingBufferSpans<T> acquireWrite(std::size_t size) {
+        return spansAt(mTail, std::min(size, getIdleSize()));
+    }
+
+    // -EINVAL if size is above the idle size
+    int32_t commitWrite(std::size_t size) {
+        if (size > getIdleSize()) {
+            return -EINVAL;
+        }
+        mTail += size;
+        return 0;
+    }
+
+    RingBufferSpans<const T> acquireRead(std::size_t size) {
+        RingBufferSpans<T> spans = spansAt(mHead, std::min(size, getAvailableSize()));
+        return { spans.first, spans.second };
+    }
+
+    // -EINVAL if size is above the available size
+    int32_t commitRead(std::size_t size) {
+        if (size > getAvailableSize()) {
+            return -EINVAL;
+        }
+        mHead += size;
+        return 0;
+    }
+
+    std::size_t getIdleSize() const {
+        return mCapacity - getAvailableSize();
+    }
+
+    std::size_t getAvailableSize() const {
+        return mTail - mHead;
+    }
+
+    std::size_t capacity() const {
+        return mCapacity;
+    }
+
+    // whether the memory is from mapHugePages, not the heap
+    bool isHugePages() const {
+        return mHugePages;
+    }
+
+ private:
+    RingBufferSpans<T> spansAt(uint64_t pos, std::size_t size) {
+        std::size_t index = pos & mMask;
+        std::size_t firstSize = std::min(size, mCapacity - index);
+        return { std::span<T>(mData + index, firstSize),
+                std::span<T>(mData, size - firstSize) };
+    }
+
+ private:
+    const std::size_t mCapacity;
+    const std::size_t mMask;
+    T *mData = nullptr;
+    bool mHugePages = false;
+    uint64_t mHead = 0U;
+    uint64_t mTail = 0U;
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_DYNAMICRINGBUFFER_HPP_
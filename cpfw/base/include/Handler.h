@@ -16,25 +16,175 @@
 #ifndef CPFW_BASE_INCLUDE_HANDLER_H_
 #define CPFW_BASE_INCLUDE_HANDLER_H_
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <span>
 #include <thread>
+#include <vector>
 
+#include "Histogram.h"
+#include "Looper.h"
 #include "Message.h"
 #include "MessagePool.h"
+#include "MessageRecycler.h"
 
 namespace cpfw {
 
+const uint32_t DEFAULT_MAX_BATCH_SIZE = 64U;
+
+struct BatchStats {
+    static constexpr std::size_t BUCKET_COUNT = 8U;
+
+    uint64_t batchCount = 0U;
+    uint64_t messageCount = 0U;
+    uint32_t lastBatchSize = 0U;
+    uint32_t maxBatchSize = 0U;
+    // bucket i counts batches whose size is in [2^i, 2^(i+1)), the last one counts the rest
+    std::array<uint64_t, BUCKET_COUNT> sizeBuckets {};
+};
+
+class Handler;
+
+/**
+ * @brief co_await it in a coroutine to go on on the thread of a Handler.
+ * e.g.: co_await handler.schedule(); co_await sleepFor(handler, 5ms);
+ * the coroutine is resumed by a message, so it is never resumed if the handler is destroyed
+ * before the message is due.
+ */
+class HandlerAwaiter {
+ public:
+    HandlerAwaiter(Handler &handler, std::chrono::nanoseconds delay)
+            : mHandler(handler), mDelay(delay) {
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    // false to go on at once if the post fails
+    bool await_suspend(std::coroutine_handle<> handle);
+
+    // 0 if resumed by the handler, else the status of the post
+    int32_t await_resume() const noexcept {
+        return mStatus;
+    }
+
+ private:
+    Handler &mHandler;
+    std::chrono::nanoseconds mDelay;
+    int32_t mStatus = 0;
+};
+
+struct HandlerStats {
+    uint64_t dispatchCount = 0U;
+    std::size_t queueDepth = 0U;
+    std::size_t maxQueueDepth = 0U;  // high-water mark
+    Histogram latencyNs;  // from post to invoke
+    Histogram lateNs;  // from deadline to invoke, delayed messages only
+    // invoke time, a batch is shared evenly by its messages
+    std::map<uint64_t/*what*/, Histogram> invokeNsByWhat;
+    BatchStats batch;
+};
+
 class Handler {
  public:
-    Handler();
+    explicit Handler(MessageQueueType type = MessageQueueType::HEAP);
+
+    /**
+     * @brief run on the worker threads of looper instead of an own thread.
+     *
+     * @param looper shared by many handlers, nullptr to have an own thread.
+     */
+    explicit Handler(std::shared_ptr<Looper> looper,
+            MessageQueueType type = MessageQueueType::HEAP);
+
     ~Handler();
 
+    /**
+     * @brief take all due messages under one lock and invoke them with onInvokeBatch.
+     *
+     * @param enable false to go back to one message per loop.
+     * @param maxBatchSize upper bound of messages taken at once.
+     */
+    void setBatchMode(bool enable, uint32_t maxBatchSize = DEFAULT_MAX_BATCH_SIZE);
+
+    BatchStats getBatchStats();
+
+    /**
+     * @brief record latency and invoke time of every message, off by default.
+     * costs two clock reads and a lock per dispatch.
+     */
+    void setStatsEnabled(bool enable);
+
+    // snapshot, the queue depths are counted even if disabled
+    HandlerStats getStats();
+
+    void resetStats();
+
+    // log a snapshot, lines begin with header
+    void dumpStats(const char *header);
+
+    /**
+     * @brief keep up to capacity invoked messages for obtain(), 0 to disable.
+     * LOOP messages are not recycled since they are posted again.
+     */
+    void setRecycleCapacity(std::size_t capacity);
+
+    // a recycled message if any, fill it and post it back with move
+    Message obtain();
+
+    void recycle(Message &&msg);
+
+    RecyclerStats getRecyclerStats();
+
     int32_t post(const Message &msg);
+    int32_t post(Message &&msg);
 
     int32_t postDelay(const Message &msg, uint64_t delayMs);
+    int32_t postDelay(Message &&msg, uint64_t delayMs);
 
+    /**
+     * @brief post with a sub-millisecond delay.
+     * e.g.: handler.postDelay(msg, 250us);
+     */
+    int32_t postDelay(const Message &msg, std::chrono::nanoseconds delay);
+    int32_t postDelay(Message &&msg, std::chrono::nanoseconds delay);
+
+    // whenMs is on the clock of getCurrentTimeMs
     int32_t postWhen(const Message &msg, uint64_t whenMs);
+    int32_t postWhen(Message &&msg, uint64_t whenMs);
+
+    int32_t postWhen(const Message &msg, std::chrono::steady_clock::time_point when);
+    int32_t postWhen(Message &&msg, std::chrono::steady_clock::time_point when);
+
+    // resume the awaiting coroutine on the thread of this handler, after the messages due
+    HandlerAwaiter schedule();
+
+    /**
+     * @brief remove pending messages of what, O(log n) each.
+     * a LOOP message being invoked at the time is not posted again.
+     */
+    void removeMessages(uint64_t what);
+
+    // whether any message of what is pending
+    bool hasMessages(uint64_t what);
+
+    /**
+     * @brief construct the message in place and move it to the queue.
+     * e.g.: handler.postEmplace(WHAT_PLAY, arg1, arg2, callback);
+     *
+     * @param what mWhat of the message.
+     * @param args the rest members of Message, in declaration order.
+     */
+    template<typename... Args>
+    int32_t postEmplace(uint64_t what, Args&&... args) {
+        return post(Message { what, std::forward<Args>(args)... });
+    }
 
     /**
      * @brief deal message actually.
@@ -47,17 +197,65 @@ class Handler {
 
     virtual void onReply(const Message &msg, const int32_t status) = 0;
 
+    /**
+     * @brief deal due messages in batch mode, in post order.
+     * default invokes and replies them one by one, override to coalesce work,
+     * then the override must reply every message itself.
+     *
+     * @param msgs what to deal.
+     */
+    virtual void onInvokeBatch(std::span<const Message> msgs);
+
+ protected:
+    void reply(const Message &msg, int32_t status);
+
  private:
+    friend class Looper;
+
+    // loop of the own thread
     void handleMessage();
 
-    void reply(const Message &msg, int32_t status);
+    // one turn on a Looper worker, return whenNs of the next message
+    uint64_t dispatchOnce();
+
+    // invoke and reply taken messages, then post LOOP ones again
+    void dispatch(std::vector<Message> &msgs, bool batchMode);
+
+    // run the runnables in place, the messages between them go to onInvokeBatch
+    void invokeBatch(std::span<const Message> msgs);
+
+    // route to the pool by flag, on the clock of getCurrentTimeNs
+    int32_t postAt(Message &&msg, uint64_t whenNs, uint64_t postNs);
+
+    /**
+     * @brief post a LOOP message again, one interval after its last deadline.
+     * so it does not drift by the invoke time, periods already missed are skipped.
+     */
+    void postNextLoop(Message &&msg);
+
+    void recordBatch(std::size_t batchSize);
+
+    void recordStats(std::span<const Message> msgs, uint64_t startNs, uint64_t endNs);
 
  private:
     std::unique_ptr<MessagePool> mMsgPool;
+    std::shared_ptr<Looper> mLooper;
+    std::vector<Message> mDueMsgs;  // only used by dispatchOnce, which is never concurrent
+    std::atomic_bool mBatchMode { false };
+    std::atomic<uint32_t> mMaxBatchSize { DEFAULT_MAX_BATCH_SIZE };
+    std::mutex mStatsMutex;
+    BatchStats mBatchStats;
+    std::atomic_bool mStatsEnabled { false };
+    HandlerStats mStats;  // without batch and queue depths, guarded by mStatsMutex
+    MessageRecycler mRecycler;
+    std::atomic_bool mRecycling { false };
     std::atomic_bool mRunning;
     std::thread mWorkingThread;
 };
 
+// resume the awaiting coroutine on the thread of handler after delay
+HandlerAwaiter sleepFor(Handler &handler, std::chrono::nanoseconds delay);
+
 }  // namesapce cpfw
 
 #endif  // CPFW_BASE_INCLUDE_HANDLER_H_
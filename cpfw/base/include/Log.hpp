@@ -27,22 +27,81 @@
 
 #include "TimeUtils.h"
 
+#ifdef CPFW_LOG_ASYNC
+#include "AsyncLog.h"
+#endif
+
+#define CPFW_LOG_LEVEL_VERBOSE 0
+#define CPFW_LOG_LEVEL_DEBUG 1
+#define CPFW_LOG_LEVEL_INFO 2
+#define CPFW_LOG_LEVEL_WARN 3
+#define CPFW_LOG_LEVEL_ERROR 4
+#define CPFW_LOG_LEVEL_FATAL 5
+#define CPFW_LOG_LEVEL_NONE 6
+
+// lowest level compiled in, the ones below compile to nothing, arguments not evaluated
+// but still used and checked against the format
+#ifndef CPFW_LOG_LEVEL
+#define CPFW_LOG_LEVEL CPFW_LOG_LEVEL_DEBUG
+#endif
+
 namespace cpfw {
 
 #ifdef __others__
 
+#else
+    // dead code, keeps the arguments used and the format checked
+    #define LOG_OFF(format, ...) do { \
+        if (false) { \
+            printf(format, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#ifdef CPFW_LOG_ASYNC
+    // formatted and printed on a background thread, the format is checked by LOG_OFF
+    #define LOG_OUT(level, format, ...) do { \
+        LOG_OFF(format, ##__VA_ARGS__); \
+        auto timeMs = getCurrentTimeMs(); \
+        ::cpfw::AsyncLog::getInstance().write("[%-12s] [%-s] [%ld] " format"\n", \
+                LOG_TAG, level, timeMs, ##__VA_ARGS__); \
+    } while (0)
 #else
     #define LOG_OUT(level, format, ...) do { \
         auto timeMs = getCurrentTimeMs(); \
         printf("[%-12s] [%-s] [%ld] " format"\n", LOG_TAG, level, timeMs, ##__VA_ARGS__); \
     } while (0)
+#endif
 
-    #define LOGV(format, ...) LOG_OUT("V", format, ##__VA_ARGS__);
-    #define LOGD(format, ...) LOG_OUT("D", format, ##__VA_ARGS__);
-    #define LOGI(format, ...) LOG_OUT("I",  format, ##__VA_ARGS__);
-    #define LOGW(format, ...) LOG_OUT("W",  format, ##__VA_ARGS__);
-    #define LOGE(format, ...) LOG_OUT("E", format, ##__VA_ARGS__);
-    #define LOGF(format, ...) LOG_OUT("F", format, ##__VA_ARGS__);
+#if CPFW_LOG_LEVEL <= CPFW_LOG_LEVEL_VERBOSE
+    #define LOGV(format, ...) LOG_OUT("V", format, ##__VA_ARGS__)
+#else
+    #define LOGV(format, ...) LOG_OFF(format, ##__VA_ARGS__)
+#endif
+#if CPFW_LOG_LEVEL <= CPFW_LOG_LEVEL_DEBUG
+    #define LOGD(format, ...) LOG_OUT("D", format, ##__VA_ARGS__)
+#else
+    #define LOGD(format, ...) LOG_OFF(format, ##__VA_ARGS__)
+#endif
+#if CPFW_LOG_LEVEL <= CPFW_LOG_LEVEL_INFO
+    #define LOGI(format, ...) LOG_OUT("I",  format, ##__VA_ARGS__)
+#else
+    #define LOGI(format, ...) LOG_OFF(format, ##__VA_ARGS__)
+#endif
+#if CPFW_LOG_LEVEL <= CPFW_LOG_LEVEL_WARN
+    #define LOGW(format, ...) LOG_OUT("W",  format, ##__VA_ARGS__)
+#else
+    #define LOGW(format, ...) LOG_OFF(format, ##__VA_ARGS__)
+#endif
+#if CPFW_LOG_LEVEL <= CPFW_LOG_LEVEL_ERROR
+    #define LOGE(format, ...) LOG_OUT("E", format, ##__VA_ARGS__)
+#else
+    #define LOGE(format, ...) LOG_OFF(format, ##__VA_ARGS__)
+#endif
+#if CPFW_LOG_LEVEL <= CPFW_LOG_LEVEL_FATAL
+    #define LOGF(format, ...) LOG_OUT("F", format, ##__VA_ARGS__)
+#else
+    #define LOGF(format, ...) LOG_OFF(format, ##__VA_ARGS__)
+#endif
 #endif
 
 }  // namespace cpfw
@@ -0,0 +1,92 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPFW_BASE_INCLUDE_LOOPER_H_
+#define CPFW_BASE_INCLUDE_LOOPER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cpfw {
+
+class Handler;
+
+/**
+ * @brief runs many Handlers on a fixed set of worker threads,
+ * instead of one thread per Handler.
+ * a Handler is run by one worker at a time, so its messages are invoked
+ * one after another in the same order as on its own thread.
+ * e.g.: auto looper = std::make_shared<Looper>(2);
+ *       StateMachine machine("machine", looper);
+ */
+class Looper {
+ public:
+    explicit Looper(uint32_t threadCount = std::thread::hardware_concurrency());
+
+    ~Looper();
+
+    Looper(const Looper&) = delete;
+    Looper& operator=(const Looper&) = delete;
+
+    std::size_t getThreadCount() const;
+
+    std::size_t getHandlerCount();
+
+ private:
+    friend class Handler;
+
+    struct Entry {
+        bool ready = false;  // in mReady
+        bool running = false;
+        bool dirty = false;  // scheduled while running, so check its queue again
+        uint64_t timerNs;  // NO_DEADLINE if no timer
+    };
+
+    void attach(Handler *handler);
+
+    // wait until no worker runs it, so must not be called from its own onInvoke
+    void detach(Handler *handler);
+
+    // the handler has a message due at whenNs, on the clock of getCurrentTimeNs
+    void schedule(Handler *handler, uint64_t whenNs);
+
+    void loop();
+
+    void readyWithLock(Handler *handler, Entry &entry);
+
+    void armTimerWithLock(Handler *handler, Entry &entry, uint64_t whenNs);
+
+ private:
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    std::condition_variable mIdleCv;
+    std::unordered_map<Handler*, Entry> mEntries;
+    std::deque<Handler*> mReady;
+    std::set<std::pair<uint64_t/*whenNs*/, Handler*>> mTimers;
+    bool mRunning = true;
+    std::vector<std::thread> mThreads;
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_LOOPER_H_
@@ -22,10 +22,17 @@
 #include <string>
 
 #include "Bundle.hpp"
+#include "SmallBundle.hpp"
 
 namespace cpfw {
 
 const std::string KEY_DELAY_TIME_MS = "delayTimeMs";
+constexpr BundleKey KEY_ID_DELAY_TIME_MS = internKey("delayTimeMs");
+// uint64_t, interval of LOOP message in nanoseconds, used before KEY_ID_DELAY_TIME_MS
+constexpr BundleKey KEY_ID_INTERVAL_NS = internKey("intervalNs");
+static_assert(areKeysDistinct({ KEY_ID_DELAY_TIME_MS, KEY_ID_INTERVAL_NS }));
+// mWhat of messages that only carry mRunnable, e.g. to resume a coroutine
+constexpr uint64_t WHAT_RUNNABLE = UINT64_MAX;
 
 enum PostFlag {
     NONE = 0x0U,
@@ -36,13 +43,20 @@ enum PostFlag {
 };
 
 struct Message {
-    uint64_t mWhat;
-    int32_t mArg1;
-    int32_t mArg2;
+    uint64_t mWhat = 0U;
+    int32_t mArg1 = 0;
+    int32_t mArg2 = 0;
 
     std::function<void(int32_t/*status*/)> mCallback;
     Bundle mBundle;
+    // no allocation for a few small values, prefer it in hot paths
+    SmallBundle mSmallBundle;
     PostFlag mFlag = PostFlag::NONE;
+    // deadline and post time on the steady clock, set by Handler when posted
+    uint64_t mWhenNs = 0U;
+    uint64_t mPostNs = 0U;
+    // run on the handler thread instead of onInvoke and reply if set
+    std::function<void()> mRunnable;
 };
 
 }  // namesapce cpfw
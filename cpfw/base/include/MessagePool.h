@@ -17,52 +17,116 @@
 #ifndef CPFW_BASE_INCLUDE_MESSAGEPOOL_H_
 #define CPFW_BASE_INCLUDE_MESSAGEPOOL_H_
 
+#include <atomic>
 #include <condition_variable>
-#include <map>
+#include <memory>
 #include <shared_mutex>
+#include <vector>
 
 #include "Message.h"
+#include "MessageQueue.h"
+#include "MpscQueue.hpp"
 
 namespace cpfw {
 
 class MessagePool {
  public:
-    MessagePool();
+    static constexpr uint64_t NO_DEADLINE = UINT64_MAX;
+
+    explicit MessagePool(MessageQueueType type = MessageQueueType::HEAP);
 
     ~MessagePool();
 
-    void post(const uint64_t whenMs, const Message &message, const uint64_t what);
+    void post(const uint64_t whenNs, Message &&message);
+
+    /**
+     * @brief post a message due now without taking the lock.
+     * it goes to an inbox which is moved to the queue by the next locked call,
+     * the lock is only taken to wake the consumer when it is waiting.
+     */
+    void postImmediate(const uint64_t whenNs, Message &&message);
 
     void postAndDeleteFormers(
-            const uint64_t whenMs, const Message &message, const uint64_t what);
+            const uint64_t whenNs, Message &&message, const uint64_t what);
 
     void postButOmitIfExist(
-            const uint64_t whenMs, const Message &message, const uint64_t what);
-
-    std::multimap<const uint64_t, const Message>::iterator front();
-
-    void popFront();
+            const uint64_t whenNs, Message &&message, const uint64_t what);
+
+    /**
+     * @brief wait for the front message to be due, then move all due messages out.
+     *
+     * @param messages where to append the due messages, in invoke order.
+     * @param maxCount upper bound of messages to move out.
+     * @return bool true if got any, false if woken up before any is due.
+     */
+    bool pollDue(std::vector<Message> &messages, const std::size_t maxCount);
+
+    /**
+     * @brief move due messages out without waiting, for a Looper.
+     *
+     * @return uint64_t whenNs of the front message left, NO_DEADLINE if none.
+     */
+    uint64_t takeDue(std::vector<Message> &messages, const std::size_t maxCount);
+
+    /**
+     * @brief remove all pending messages of what.
+     * a LOOP message of what taken out and not posted back yet is cancelled too.
+     */
+    void erase(const uint64_t what);
+
+    /**
+     * @brief post a LOOP message taken by pollDue or takeDue back.
+     *
+     * @return bool false if it is dropped, as erase of its what came after the take.
+     */
+    bool repostLoop(const uint64_t whenNs, Message &&message);
+
+    // a taken LOOP message is not posted back, stop tracking it
+    void dropLoop(const uint64_t what);
+
+    bool contains(const uint64_t what);
 
     void clear();
 
     void notify();
 
-    void wait();
+    std::size_t size();
 
-    std::cv_status waitFor(uint64_t waitTimeMs = UINT64_MAX);
+    // high-water mark of size, immediate posts are counted once moved from the inbox
+    std::size_t getMaxSize();
 
  private:
-    void postWithLock(
-            const uint64_t whenMs, const Message &message, const uint64_t what);
+    void postWithLock(const uint64_t whenNs, Message &&message);
+
+    void takeDueWithLock(std::vector<Message> &messages, const std::size_t maxCount,
+            const uint64_t currentTimeNs);
+
+    // the inbox has a single consumer, so only drain it with the unique lock held
+    void drainInboxWithLock();
 
-    void deleteMessage(const uint64_t what);
+    // stop tracking a taken LOOP message, return whether it was cancelled
+    bool releaseLoopWithLock(const uint64_t what);
 
-    bool findEntry(const uint64_t what);
+    // wait with the unique lock held, return at once if the inbox is not empty
+    template<typename TWait>
+    void waitWithLock(TWait wait);
 
  private:
-    std::multimap<const uint64_t/*whenMs*/, const Message> mQueue;
-    // perf for find when post with flag delete or omit
-    std::multimap<uint64_t/*what*/, uint64_t/*whenMs*/> mFlagTable;
+    struct InboxEntry {
+        uint64_t whenNs;
+        Message message;
+    };
+
+    struct TakenLoop {
+        uint64_t what;
+        bool cancelled;
+    };
+
+    std::unique_ptr<MessageQueue> mQueue;
+    std::size_t mMaxSize = 0U;
+    std::vector<TakenLoop> mTakenLoops;  // few, one per LOOP message being invoked
+    MpscQueue<InboxEntry> mInbox;
+    std::atomic_bool mWaiting { false };
     mutable std::shared_mutex mMutex;
     std::condition_variable_any mCv;
 };
@@ -0,0 +1,204 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPFW_BASE_INCLUDE_MESSAGEQUEUE_H_
+#define CPFW_BASE_INCLUDE_MESSAGEQUEUE_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "Message.h"
+
+namespace cpfw {
+
+enum class MessageQueueType : uint8_t {
+    MULTIMAP,  // ordered tree, one node allocation per message
+    HEAP,  // binary heap over slab slots, fifo fast path for due messages
+};
+
+/**
+ * @brief storage backend of MessagePool, ordered by whenNs then by post order.
+ * no lock in, MessagePool holds the lock when calling the interface.
+ */
+class MessageQueue {
+ public:
+    static std::unique_ptr<MessageQueue> create(MessageQueueType type);
+
+    virtual ~MessageQueue() = default;
+
+    /**
+     * @brief insert message.
+     *
+     * @param whenNs when to invoke.
+     * @param message what to invoke.
+     * @param due whenNs has already passed, which allows an O(1) fast path.
+     */
+    virtual void push(const uint64_t whenNs, Message &&message, const bool due) = 0;
+
+    // only valid when not empty
+    virtual uint64_t frontWhenNs() const = 0;
+
+    // move the front message out and remove it, only valid when not empty
+    virtual void popFront(Message &message) = 0;
+
+    virtual void erase(const uint64_t what) = 0;
+
+    virtual bool contains(const uint64_t what) const = 0;
+
+    virtual void clear() = 0;
+
+    virtual bool empty() const = 0;
+
+    virtual std::size_t size() const = 0;
+};
+
+/**
+ * the original backend, one tree node allocated per message.
+ * each what keeps a set of its queue iterators, so erase only visits matching messages.
+ */
+class MultimapMessageQueue : public MessageQueue {
+ public:
+    void push(const uint64_t whenNs, Message &&message, const bool due) override;
+
+    uint64_t frontWhenNs() const override;
+
+    void popFront(Message &message) override;
+
+    void erase(const uint64_t what) override;
+
+    bool contains(const uint64_t what) const override;
+
+    void clear() override;
+
+    bool empty() const override;
+
+    std::size_t size() const override;
+
+ private:
+    using Queue = std::multimap<uint64_t/*whenNs*/, Message>;
+
+    struct IteratorLess {
+        bool operator()(const Queue::iterator &left, const Queue::iterator &right) const {
+            return &*left < &*right;
+        }
+    };
+
+ private:
+    Queue mQueue;
+    // perf for find when post with flag delete or omit
+    std::unordered_map<uint64_t/*what*/, std::set<Queue::iterator, IteratorLess>> mFlagTable;
+};
+
+/**
+ * messages live in a slab whose slots are reused, so no allocation per message
+ * once the slab has grown to the working set.
+ * due messages are appended to a fifo list in O(1), others go to a binary heap of
+ * small keys, the front is the smaller head of the two.
+ * every slot knows where it is in the heap or the fifo, and is linked with the other
+ * slots of the same what, so erase(what) is O(log n) per message removed.
+ */
+class HeapMessageQueue : public MessageQueue {
+ public:
+    void push(const uint64_t whenNs, Message &&message, const bool due) override;
+
+    uint64_t frontWhenNs() const override;
+
+    void popFront(Message &message) override;
+
+    void erase(const uint64_t what) override;
+
+    bool contains(const uint64_t what) const override;
+
+    void clear() override;
+
+    bool empty() const override;
+
+    std::size_t size() const override;
+
+ private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Key {
+        uint64_t whenNs;
+        uint64_t sequence;
+        uint32_t slot;
+    };
+
+    // links of a slot, apart from the message so walking them stays in cache
+    struct Node {
+        Key key;
+        uint64_t what = 0U;  // kept here, the message may be moved out before release
+        uint32_t heapIndex = NIL;  // NIL if in the fifo
+        uint32_t prev = NIL;  // links in the fifo
+        uint32_t next = NIL;
+        uint32_t whatPrev = NIL;  // links with the same what
+        uint32_t whatNext = NIL;
+    };
+
+    struct WhatList {
+        uint32_t head = NIL;
+        uint32_t count = 0U;
+    };
+
+    static bool earlier(const Key &left, const Key &right) {
+        if (left.whenNs != right.whenNs) {
+            return left.whenNs < right.whenNs;
+        }
+        return left.sequence < right.sequence;
+    }
+
+    uint32_t allocateSlot(Message &&message);
+
+    // unlink from what list and free the slot, it must be out of heap and fifo
+    void releaseSlot(const uint32_t slot);
+
+    // take out of heap or fifo, then release
+    void removeSlot(const uint32_t slot);
+
+    void heapPush(const Key &key);
+
+    void heapRemove(const uint32_t index);
+
+    void heapPlace(const uint32_t index, const Key &key);
+
+    void siftUp(uint32_t index);
+
+    void siftDown(uint32_t index);
+
+    void fifoPushBack(const uint32_t slot);
+
+    void fifoUnlink(const uint32_t slot);
+
+    bool isFrontInFifo() const;
+
+ private:
+    std::vector<Message> mSlots;
+    std::vector<Node> mNodes;  // parallel to mSlots
+    std::vector<uint32_t> mFreeSlots;
+    std::vector<Key> mHeap;  // min heap
+    uint32_t mFifoHead = NIL;  // whenNs non-decreasing
+    uint32_t mFifoTail = NIL;
+    std::size_t mFifoSize = 0U;
+    std::unordered_map<uint64_t/*what*/, WhatList> mWhatTable;
+    uint64_t mSequence = 0U;
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_MESSAGEQUEUE_H_
@@ -0,0 +1,78 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPFW_BASE_INCLUDE_MESSAGERECYCLER_H_
+#define CPFW_BASE_INCLUDE_MESSAGERECYCLER_H_
+
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include "Message.h"
+
+namespace cpfw {
+
+struct RecyclerStats {
+    uint64_t obtainCount = 0U;
+    uint64_t hitCount = 0U;  // obtained from the free list
+    uint64_t recycleCount = 0U;
+    uint64_t dropCount = 0U;  // recycled while the free list is full
+
+    double getHitRate() const {
+        return obtainCount == 0U ? 0.0 : static_cast<double>(hitCount) / obtainCount;
+    }
+};
+
+/**
+ * @brief free list of messages, like Message.obtain() of android.
+ * recycled messages are reset, their small bundle values which have clear(),
+ * such as vectors and strings, are only cleared and kept dormant, so the
+ * capacity is reused by the next owner through SmallBundle::getMutable or set,
+ * while the keys look absent until then.
+ */
+class MessageRecycler {
+ public:
+    explicit MessageRecycler(std::size_t capacity = 0U);
+
+    void setCapacity(std::size_t capacity);
+
+    std::size_t getCapacity();
+
+    // a recycled message if any, else a new one
+    Message obtain();
+
+    void recycle(Message &&message);
+
+    // recycle a batch under one lock
+    void recycle(std::span<Message> messages);
+
+    RecyclerStats getStats();
+
+ private:
+    static void reset(Message &message);
+
+    void recycleWithLock(Message &&message);
+
+ private:
+    std::mutex mMutex;
+    std::size_t mCapacity;
+    std::vector<Message> mFreeList;
+    RecyclerStats mStats;
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_MESSAGERECYCLER_H_
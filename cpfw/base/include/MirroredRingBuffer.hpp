@@ -0,0 +1,146 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPFW_BASE_INCLUDE_MIRROREDRINGBUFFER_HPP_
+#define CPFW_BASE_INCLUDE_MIRROREDRINGBUFFER_HPP_
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#include "MemoryUtils.h"
+
+namespace cpfw {
+
+/**
+ * @brief RingBuffer whose memory is mapped twice back to back, so the idle and the available
+ * range are always one contiguous span, no wraparound: a single memcpy, or a read()/write()
+ * syscall straight on the buffer.
+ * e.g.: auto idle = rb.acquireWrite(n); ssize_t got = ::read(fd, idle.data(), idle.size_bytes());
+ *       rb.commitWrite(got / sizeof(T));
+ * linux only, check valid() after construction. no lock in, as RingBuffer.
+ */
+template<typename T>
+class MirroredRingBuffer {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+    static_assert(std::has_single_bit(sizeof(T)), "size of T must be a power of 2");
+
+ public:
+    // capacity is rounded up to whole pages
+    explicit MirroredRingBuffer(std::size_t capacity) {
+        std::size_t pageSize = getPageSize();
+        std::size_t bytes = std::max<std::size_t>(capacity * sizeof(T), 1U);
+        bytes = (bytes + pageSize - 1U) / pageSize * pageSize;
+        void *data = nullptr;
+        if (0 == mapMirrored(bytes, &data)) {
+            mData = static_cast<T*>(data);
+            mCapacity = bytes / sizeof(T);
+        }
+    }
+
+    ~MirroredRingBuffer() {
+        unmapMirrored(mData, mCapacity * sizeof(T));
+    }
+
+    MirroredRingBuffer(const MirroredRingBuffer&) = delete;
+    MirroredRingBuffer& operator=(const MirroredRingBuffer&) = delete;
+
+    // false if the memory could not be mapped, then nothing fits in it
+    bool valid() const {
+        return nullptr != mData;
+    }
+
+    // all or nothing, -EAGAIN if idle size is not enough
+    int32_t write(std::span<const T> writeBuffer) {
+        if (writeBuffer.size() > getIdleSize()) {
+            return -EAGAIN;
+        }
+        std::memcpy(mData + mTailPos, writeBuffer.data(), writeBuffer.size_bytes());
+        return commitWrite(writeBuffer.size());
+    }
+
+    // all or nothing, -EAGAIN if available size is not enough
+    int32_t read(std::span<T> readBuffer) {
+        if (readBuffer.size() > mAvailableSize) {
+            return -EAGAIN;
+        }
+        std::memcpy(readBuffer.data(), mData + mHeadPos, readBuffer.size_bytes());
+        return commitRead(readBuffer.size());
+    }
+
+    // contiguous idle space to fill in place, shorter than size if the idle size is
+    std::span<T> acquireWrite(std::size_t size) {
+        return std::span<T>(mData + mTailPos, std::min(size, getIdleSize()));
+    }
+
+    // -EINVAL if size is above the idle size
+    int32_t commitWrite(std::size_t size) {
+        if (size > getIdleSize()) {
+            return -EINVAL;
+        }
+        mTailPos = wrap(mTailPos + size);
+        mAvailableSize += size;
+        return 0;
+    }
+
+    // contiguous data to use in place, shorter than size if the available size is
+    std::span<const T> acquireRead(std::size_t size) {
+        return std::span<const T>(mData + mHeadPos, std::min(size, mAvailableSize));
+    }
+
+    // -EINVAL if size is above the available size
+    int32_t commitRead(std::size_t size) {
+        if (size > mAvailableSize) {
+            return -EINVAL;
+        }
+        mHeadPos = wrap(mHeadPos + size);
+        mAvailableSize -= size;
+        return 0;
+    }
+
+    std::size_t getIdleSize() const {
+        return mCapacity - mAvailableSize;
+    }
+
+    std::size_t getAvailableSize() const {
+        return mAvailableSize;
+    }
+
+    std::size_t capacity() const {
+        return mCapacity;
+    }
+
+ private:
+    std::size_t wrap(std::size_t pos) const {
+        return pos >= mCapacity ? pos - mCapacity : pos;
+    }
+
+ private:
+    T *mData = nullptr;  // 2 * mCapacity, the second half mirrors the first
+    std::size_t mCapacity = 0U;
+    std::size_t mHeadPos = 0U;
+    std::size_t mTailPos = 0U;
+    std::size_t mAvailableSize = 0U;
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_MIRROREDRINGBUFFER_HPP_
@@ -0,0 +1,254 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPFW_BASE_INCLUDE_MPMCQUEUE_HPP_
+#define CPFW_BASE_INCLUDE_MPMCQUEUE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace cpfw {
+
+/**
+ * @brief bounded multi-producer multi-consumer queue, no lock in tryPush and tryPop.
+ * every slot has a sequence number that tells whose turn it is, so producers and consumers
+ * only race on a CAS of their own position (Vyukov).
+ * push and pop block when full or empty, they spin a while and then wait on a condition
+ * variable, which is only touched by the other side when somebody waits.
+ * T must be default constructible and move assignable.
+ */
+template<typename T>
+class MpmcQueue {
+ public:
+    // rounded up to a power of 2, 2 at least
+    explicit MpmcQueue(std::size_t capacity) {
+        std::size_t size = 2U;
+        while (size < capacity) {
+            size <<= 1U;
+        }
+        mMask = size - 1U;
+        mSlots = std::make_unique<Slot[]>(size);
+        for (std::size_t i=0; i<size; ++i) {
+            mSlots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // false if full, value is moved only on success
+    template<class U>
+    bool tryPush(U &&value) {
+        if (!enqueue(std::forward<U>(value))) {
+            return false;
+        }
+        wake(mPopWaiters, mNotEmpty);
+        return true;
+    }
+
+    // false if empty
+    bool tryPop(T &value) {
+        if (!dequeue(value)) {
+            return false;
+        }
+        wake(mPushWaiters, mNotFull);
+        return true;
+    }
+
+    // wait while full
+    template<class U>
+    void push(U &&value) {
+        pushWith(std::forward<U>(value), [](auto &lock, std::condition_variable &cv) {
+            cv.wait(lock);
+            return true;
+        });
+    }
+
+    // wait while empty
+    void pop(T &value) {
+        popWith(value, [](auto &lock, std::condition_variable &cv) {
+            cv.wait(lock);
+            return true;
+        });
+    }
+
+    // false if still full after timeout
+    template<class U>
+    bool pushFor(U &&value, std::chrono::nanoseconds timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        return pushWith(std::forward<U>(value), [deadline](auto &lock,
+                std::condition_variable &cv) {
+            return std::cv_status::timeout != cv.wait_until(lock, deadline);
+        });
+    }
+
+    // false if still empty after timeout
+    bool popFor(T &value, std::chrono::nanoseconds timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        return popWith(value, [deadline](auto &lock, std::condition_variable &cv) {
+            return std::cv_status::timeout != cv.wait_until(lock, deadline);
+        });
+    }
+
+    std::size_t capacity() const {
+        return mMask + 1U;
+    }
+
+    // a hint only when other threads are working on it
+    std::size_t size() const {
+        uint64_t dequeuePos = mDequeuePos.load(std::memory_order_acquire);
+        uint64_t enqueuePos = mEnqueuePos.load(std::memory_order_acquire);
+        return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0U;
+    }
+
+ private:
+    static constexpr uint32_t SPIN_COUNT = 64U;
+
+    struct Slot {
+        // pos when free for the push at pos, pos + 1 when full for the pop at pos
+        std::atomic<uint64_t> sequence;
+        T value;
+    };
+
+    template<class U>
+    bool enqueue(U &&value) {
+        uint64_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        Slot *slot = nullptr;
+        while (true) {
+            slot = &mSlots[pos & mMask];
+            uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(sequence - pos);
+            if (0 == diff) {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1U,
+                        std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // the slot of a lap ago is not popped yet
+            } else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = std::forward<U>(value);
+        slot->sequence.store(pos + 1U, std::memory_order_release);
+        return true;
+    }
+
+    bool dequeue(T &value) {
+        uint64_t pos = mDequeuePos.load(std::memory_order_relaxed);
+        Slot *slot = nullptr;
+        while (true) {
+            slot = &mSlots[pos & mMask];
+            uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(sequence - (pos + 1U));
+            if (0 == diff) {
+                if (mDequeuePos.compare_exchange_weak(pos, pos + 1U,
+                        std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // not pushed yet
+            } else {
+                pos = mDequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(slot->value);
+        slot->sequence.store(pos + mMask + 1U, std::memory_order_release);
+        return true;
+    }
+
+    void wake(std::atomic<uint32_t> &waiters, std::condition_variable &cv) {
+        // pairs with the increase of waiters in waitFor
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0U) {
+            std::lock_guard<std::mutex> lock { mLock };
+            cv.notify_one();
+        }
+    }
+
+    /**
+     * spin on attempt, then wait on cv under mLock till it succeeds or wait says timeout.
+     * a change made before the waiter count goes up is seen by attempt, one after sees the
+     * count and notifies.
+     */
+    template<class ATTEMPT, class WAIT>
+    bool waitFor(ATTEMPT &&attempt, std::atomic<uint32_t> &waiters,
+            std::condition_variable &cv, WAIT &&wait) {
+        for (uint32_t i=0; i<SPIN_COUNT; ++i) {
+            if (attempt()) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> lock { mLock };
+        waiters.fetch_add(1U, std::memory_order_seq_cst);
+        bool done = false;
+        while (!(done = attempt())) {
+            if (!wait(lock, cv)) {
+                done = attempt();
+                break;
+            }
+        }
+        waiters.fetch_sub(1U, std::memory_order_relaxed);
+        return done;
+    }
+
+    template<class U, class WAIT>
+    bool pushWith(U &&value, WAIT &&wait) {
+        bool pushed = waitFor([this, &value] {
+            return enqueue(std::forward<U>(value));
+        }, mPushWaiters, mNotFull, wait);
+        if (pushed) {
+            wake(mPopWaiters, mNotEmpty);
+        }
+        return pushed;
+    }
+
+    template<class WAIT>
+    bool popWith(T &value, WAIT &&wait) {
+        bool popped = waitFor([this, &value] {
+            return dequeue(value);
+        }, mPopWaiters, mNotEmpty, wait);
+        if (popped) {
+            wake(mPushWaiters, mNotFull);
+        }
+        return popped;
+    }
+
+ private:
+    std::unique_ptr<Slot[]> mSlots;
+    std::size_t mMask = 0U;
+    // producers and consumers move different positions, keep them on different cache lines
+    alignas(64) std::atomic<uint64_t> mEnqueuePos { 0U };
+    alignas(64) std::atomic<uint64_t> mDequeuePos { 0U };
+    alignas(64) std::atomic<uint32_t> mPushWaiters { 0U };
+    std::atomic<uint32_t> mPopWaiters { 0U };
+    std::mutex mLock;  // for waiting only
+    std::condition_variable mNotFull;
+    std::condition_variable mNotEmpty;
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_MPMCQUEUE_HPP_
@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPFW_BASE_INCLUDE_MPSCQUEUE_HPP_
+#define CPFW_BASE_INCLUDE_MPSCQUEUE_HPP_
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "BlockPool.hpp"
+
+namespace cpfw {
+
+/**
+ * @brief unbounded multi-producer single-consumer queue.
+ * push can be called from any thread, pop and empty must only be called from one
+ * consumer at a time.
+ * nodes come from BlockPool, so push is lock-free but for one lock per
+ * BlockPool::BATCH nodes, when the consumer has freed them to the depot and a
+ * producer takes them back.
+ */
+template<typename T>
+class MpscQueue {
+ public:
+    MpscQueue() {
+        Node *stub = newNode();
+        mHead.store(stub);
+        mTail = stub;
+    }
+
+    ~MpscQueue() {
+        T value;
+        while (pop(value)) {
+        }
+        deleteNode(mTail);
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value) {
+        Node *node = newNode();
+        node->value = std::move(value);
+        Node *prev = mHead.exchange(node);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * @brief pop the oldest value.
+     * may return false for a moment while a producer is between its two steps,
+     * check empty() to tell it from a really empty queue.
+     */
+    bool pop(T &value) {
+        Node *tail = mTail;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (nullptr == next) {
+            return false;
+        }
+        value = std::move(next->value);
+        mTail = next;  // next becomes the new stub
+        deleteNode(tail);
+        return true;
+    }
+
+    // seq_cst, so it pairs with a flag stored by the consumer before waiting
+    [[nodiscard]] bool empty() const {
+        return mHead.load() == mTail;
+    }
+
+ private:
+    struct Node {
+        std::atomic<Node*> next { nullptr };
+        T value;
+    };
+
+    static Node* newNode() {
+        return std::construct_at(PoolAllocator<Node>().allocate(1));
+    }
+
+    static void deleteNode(Node *node) {
+        std::destroy_at(node);
+        PoolAllocator<Node>().deallocate(node, 1);
+    }
+
+    // producers and the consumer touch different ends, keep them on different cache lines
+    alignas(64) std::atomic<Node*> mHead;
+    alignas(64) Node *mTail;
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_MPSCQUEUE_HPP_
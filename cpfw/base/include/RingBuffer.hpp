@@ -13,12 +13,29 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#ifndef CPFW_BASE_INCLUDE_RINGBUFFER_HPP_
+#define CPFW_BASE_INCLUDE_RINGBUFFER_HPP_
+
 #include <algorithm>
 #include <array>
+#include <cerrno>
+#include <cstdint>
+#include <span>
 #include <vector>
 
 namespace cpfw {
 
+// a range of a ring in up to two contiguous parts, second is empty unless it wraps around
+template<typename T>
+struct RingBufferSpans {
+    std::span<T> first;
+    std::span<T> second;
+
+    std::size_t size() const {
+        return first.size() + second.size();
+    }
+};
+
 /**
  *  no lock in the RingerBuffer,
  *  users should ensure there is no resource competition when call the interface
@@ -30,6 +47,13 @@ class RingBuffer {
     }
 
     int32_t write(const std::vector<T> &writeBuffer) {
+        return write(std::span<const T>(writeBuffer));
+    }
+
+    int32_t write(std::span<const T> writeBuffer) {
+        if (mOverwriteOldest && writeBuffer.size() > static_cast<std::size_t>(getIdleSize())) {
+            dropOldest(writeBuffer);
+        }
         std::size_t writeSize = writeBuffer.size();
         std::size_t residualSize = N - mTailPos;
 
@@ -47,6 +71,12 @@ class RingBuffer {
 
     int32_t read(std::vector<T> &readBuffer, std::size_t readSize) {
         readBuffer.resize(readSize);
+        return read(std::span<T>(readBuffer));
+    }
+
+    // fill all of readBuffer, no resize
+    int32_t read(std::span<T> readBuffer) {
+        std::size_t readSize = readBuffer.size();
         std::size_t residualSize = N - mHeadPos;
         if (residualSize < readSize) {
             std::ranges::copy_n(
@@ -60,6 +90,54 @@ class RingBuffer {
         return 0;
     }
 
+    /**
+     * @brief idle space to fill in place, then commitWrite what was filled.
+     * e.g.: auto spans = rb.acquireWrite(n); fill spans.first then spans.second; rb.commitWrite(k);
+     *
+     * @param size wanted, the spans are shorter if the idle size is.
+     */
+    RingBufferSpans<T> acquireWrite(std::size_t size) {
+        return spansAt(mTailPos, std::min<std::size_t>(size, getIdleSize()));
+    }
+
+    // -EINVAL if size is above the idle size
+    int32_t commitWrite(std::size_t size) {
+        if (size > static_cast<std::size_t>(getIdleSize())) {
+            return -EINVAL;
+        }
+        expand(size);
+        return 0;
+    }
+
+    // data to use in place, then commitRead what was used to free it
+    RingBufferSpans<const T> acquireRead(std::size_t size) {
+        RingBufferSpans<T> spans = spansAt(mHeadPos,
+                std::min<std::size_t>(size, getAvailableSize()));
+        return { spans.first, spans.second };
+    }
+
+    // -EINVAL if size is above the available size
+    int32_t commitRead(std::size_t size) {
+        if (size > static_cast<std::size_t>(getAvailableSize())) {
+            return -EINVAL;
+        }
+        shrink(size);
+        return 0;
+    }
+
+    /**
+     * @brief on overrun, drop the oldest data to make room instead of corrupting it,
+     * so a slow reader never holds up the writer. off by default.
+     */
+    void setOverwriteOldest(bool enable) {
+        mOverwriteOldest = enable;
+    }
+
+    // elements dropped by overwrite oldest
+    uint64_t getDroppedCount() {
+        return mDroppedCount;
+    }
+
     int32_t getIdleSize() {
         return N - mAvailableSize;
     }
@@ -83,6 +161,23 @@ class RingBuffer {
 #endif
 
  private:
+    // move the head past what writeBuffer overruns, keep only the newest N of writeBuffer
+    void dropOldest(std::span<const T> &writeBuffer) {
+        if (writeBuffer.size() > N) {
+            mDroppedCount += writeBuffer.size() - N;
+            writeBuffer = writeBuffer.last(N);
+        }
+        std::size_t overrun = writeBuffer.size() - getIdleSize();
+        shrink(overrun);
+        mDroppedCount += overrun;
+    }
+
+    RingBufferSpans<T> spansAt(std::size_t pos, std::size_t size) {
+        std::size_t firstSize = std::min<std::size_t>(size, N - pos);
+        return { std::span<T>(mBuffer.data() + pos, firstSize),
+                std::span<T>(mBuffer.data(), size - firstSize) };
+    }
+
     void expand(int32_t size) {
         mTailPos += size;
         if (mTailPos >= N) {
@@ -110,7 +205,10 @@ class RingBuffer {
     int32_t mHeadPos = 0;
     int32_t mTailPos = 0;
     int32_t mAvailableSize = 0;
+    bool mOverwriteOldest = false;
+    uint64_t mDroppedCount = 0U;
 };
 
 }  // namespace cpfw
 
+#endif  // CPFW_BASE_INCLUDE_RINGBUFFER_HPP_
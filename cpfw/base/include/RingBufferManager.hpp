@@ -15,6 +15,9 @@
  */
 #define LOG_TAG "RingBufferManager"
 
+#include <atomic>
+#include <cerrno>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <memory>
@@ -29,14 +32,19 @@
 namespace cpfw {
 
 namespace {
-    const std::string KEY_WRITE = "funcWrite";
-    const std::string KEY_READ = "funcRead";
-    const std::string KEY_DATA = "data";
+    constexpr BundleKey KEY_ID_WRITE = internKey("funcWrite");
+    constexpr BundleKey KEY_ID_READ = internKey("funcRead");
+    constexpr BundleKey KEY_ID_DATA = internKey("data");
+    // with the keys Handler reads from a LOOP message
+    static_assert(areKeysDistinct({ KEY_ID_WRITE, KEY_ID_READ, KEY_ID_DATA,
+            KEY_ID_DELAY_TIME_MS, KEY_ID_INTERVAL_NS }));
 
     const uint32_t WHAT_WRITE_DIRECT = 0U;
     const uint32_t WHAT_WRITE_LOOP = 1U;
     const uint32_t WHAT_READ_DIRECT = 2U;
     const uint32_t WHAT_READ_LOOP = 3U;
+
+    const std::size_t WRITE_RECYCLE_CAPACITY = 8U;
 }
 
 template<typename T, int32_t N>
@@ -45,70 +53,109 @@ class RingBufferManager {
     using FUNCTION_READ = std::function<int32_t(std::vector<T> &readBuffer, int32_t readSize)>;
     using FUNCTION_WRITE = std::function<int32_t()>;
 
-    explicit RingBufferManager(const std::string &name = "default") : mName(name) {
+    /**
+     * @param looper runs the write and read handlers, nullptr for a thread each.
+     * blocked writes wait for reads on it, so give it 2 threads at least.
+     */
+    explicit RingBufferManager(const std::string &name = "default",
+            std::shared_ptr<Looper> looper = nullptr) : mName(name), mLooper(looper) {
     }
 
     int32_t write(const std::vector<T> &writeBuffer) {
+        if (mOverwriteOldest) {
+            return writeLossy(writeBuffer);
+        }
         if (mBuffer.getIdleSize() >= writeBuffer.size()) {
             return writeLock(writeBuffer);
         }
 
-        Message msg;
-        msg.mWhat = WHAT_WRITE_DIRECT;
-        Bundle bundle;
-        bundle.set(KEY_DATA, writeBuffer);
-        msg.mBundle = bundle;
+        // a recycled message brings a data vector whose capacity is reused
         makeWriteHandlerIfNull();
-        mWriteHandler->post(msg);
+        Message msg = mWriteHandler->obtain();
+        msg.mWhat = WHAT_WRITE_DIRECT;
+        msg.mSmallBundle.getMutable<std::vector<T>>(KEY_ID_DATA).assign(
+                writeBuffer.begin(), writeBuffer.end());
+        mWriteHandler->post(std::move(msg));
         return 0;
     }
 
+    // the data is moved into the message if it has to wait for idle space
+    int32_t write(std::vector<T> &&writeBuffer) {
+        if (mOverwriteOldest) {
+            return writeLossy(writeBuffer);
+        }
+        if (mBuffer.getIdleSize() >= writeBuffer.size()) {
+            return writeLock(writeBuffer);
+        }
+        return postWrite(std::move(writeBuffer));
+    }
+
     int32_t read(std::vector<T> &readBuffer, int32_t readSize) {
         return readLock(readBuffer, readSize);
     }
 
+    /**
+     * @brief lossy streaming, e.g. telemetry: write never blocks nor queues, on overrun the
+     * oldest data is dropped and counted. reads then take the lock too, since the writer
+     * moves the head. set it before any write or read.
+     */
+    void setOverwriteOldest(bool enable) {
+        std::unique_lock<std::shared_mutex> lck(mMutex);
+        mBuffer.setOverwriteOldest(enable);
+        mOverwriteOldest = enable;
+    }
+
+    // elements dropped by overwrite oldest
+    uint64_t getDroppedCount() {
+        std::unique_lock<std::shared_mutex> lck(mMutex);
+        return mBuffer.getDroppedCount();
+    }
+
     int32_t registerWrite(FUNCTION_WRITE funcWrite, uint64_t intervalTimeMs) {
+        return registerWrite(funcWrite, std::chrono::milliseconds(intervalTimeMs));
+    }
+
+    // called every interval from the first deadline on, no drift by the invoke time
+    int32_t registerWrite(FUNCTION_WRITE funcWrite, std::chrono::nanoseconds interval) {
         Message msg;
         msg.mWhat = WHAT_WRITE_LOOP;
         msg.mFlag = PostFlag::LOOP;
-        Bundle bundle;
-        bundle.set(KEY_DELAY_TIME_MS, intervalTimeMs);
-        bundle.set(KEY_WRITE, funcWrite);
-        msg.mBundle = bundle;
+        msg.mSmallBundle.set(KEY_ID_INTERVAL_NS, static_cast<uint64_t>(interval.count()));
+        msg.mSmallBundle.set(KEY_ID_WRITE, funcWrite);
         makeWriteHandlerIfNull();
-        mWriteHandler->post(msg);
+        mWriteHandler->post(std::move(msg));
         return 0;
     }
 
+    // the loop being invoked at the time is not posted again
     int32_t unregisterWrite() {
-        Message msg;
-        msg.mWhat = WHAT_WRITE_LOOP;
-        msg.mFlag = PostFlag::DELETE_FORMER;
-        makeWriteHandlerIfNull();
-        mWriteHandler->post(msg);
+        if (mWriteHandler) {
+            mWriteHandler->removeMessages(WHAT_WRITE_LOOP);
+        }
         return 0;
     }
 
     int32_t registerRead(FUNCTION_READ funcRead, int32_t readSize, uint64_t intervalTimeMs) {
+        return registerRead(funcRead, readSize, std::chrono::milliseconds(intervalTimeMs));
+    }
+
+    int32_t registerRead(FUNCTION_READ funcRead, int32_t readSize,
+            std::chrono::nanoseconds interval) {
         Message msg;
         msg.mWhat = WHAT_READ_LOOP;
         msg.mFlag = PostFlag::LOOP;
         msg.mArg1 = readSize;
-        Bundle bundle;
-        bundle.set(KEY_DELAY_TIME_MS, intervalTimeMs);
-        bundle.set(KEY_READ, funcRead);
-        msg.mBundle = bundle;
+        msg.mSmallBundle.set(KEY_ID_INTERVAL_NS, static_cast<uint64_t>(interval.count()));
+        msg.mSmallBundle.set(KEY_ID_READ, funcRead);
         makeReadHandlerIfNull();
-        mReadHandler->post(msg);
+        mReadHandler->post(std::move(msg));
         return 0;
     }
 
     int32_t unregisterRead() {
-        Message msg;
-        msg.mWhat = WHAT_READ_LOOP;
-        msg.mFlag = PostFlag::DELETE_FORMER;
-        makeReadHandlerIfNull();
-        mReadHandler->post(msg);
+        if (mReadHandler) {
+            mReadHandler->removeMessages(WHAT_READ_LOOP);
+        }
         return 0;
     }
 
@@ -119,15 +166,24 @@ class RingBufferManager {
 #endif
 
  private:
+    int32_t postWrite(std::vector<T> &&writeBuffer) {
+        Message msg;
+        msg.mWhat = WHAT_WRITE_DIRECT;
+        msg.mSmallBundle.set(KEY_ID_DATA, std::move(writeBuffer));
+        makeWriteHandlerIfNull();
+        mWriteHandler->post(std::move(msg));
+        return 0;
+    }
+
     void makeWriteHandlerIfNull() {
         if (!mWriteHandler) {
-            mWriteHandler = std::make_unique<WriteRingHandler>(this);
+            mWriteHandler = std::make_unique<WriteRingHandler>(this, mLooper);
         }
     }
 
     void makeReadHandlerIfNull() {
         if (!mReadHandler) {
-            mReadHandler = std::make_unique<ReadRingHandler>(this);
+            mReadHandler = std::make_unique<ReadRingHandler>(this, mLooper);
         }
     }
 
@@ -142,7 +198,23 @@ class RingBufferManager {
         return 0;
     }
 
+    int32_t writeLossy(const std::vector<T> &writeBuffer) {
+        {
+            std::unique_lock<std::shared_mutex> lck(mMutex);
+            mBuffer.write(writeBuffer);
+        }
+        mConditionVariable.notify_all();
+        return 0;
+    }
+
     int32_t readLock(std::vector<T> &readBuffer, int32_t readSize) {
+        if (mOverwriteOldest) {
+            std::unique_lock<std::shared_mutex> lck(mMutex);
+            mConditionVariable.wait(lck, [this, readSize] {
+                return mBuffer.getAvailableSize() >= readSize;
+            });
+            return mBuffer.read(readBuffer, readSize);
+        }
         while (mBuffer.getAvailableSize() < readSize) {
             LOGW("%s underrun", mName.c_str());
             std::shared_lock<std::shared_mutex> lck(mMutex);
@@ -155,21 +227,25 @@ class RingBufferManager {
 
     class WriteRingHandler : public Handler {
      public:
-        WriteRingHandler(RingBufferManager *rbm) : mRmb(rbm) {
+        WriteRingHandler(RingBufferManager *rbm, std::shared_ptr<Looper> looper)
+                : Handler(looper), mRmb(rbm) {
+            setRecycleCapacity(WRITE_RECYCLE_CAPACITY);
         }
 
         int32_t onInvoke(const Message &message) override {
-            Bundle &bundle = const_cast<Message&>(message).mBundle;
+            const SmallBundle &bundle = message.mSmallBundle;
             switch (message.mWhat) {
             case WHAT_WRITE_DIRECT: {
-                std::vector<T> writeBuffer;
-                bundle.get(KEY_DATA, writeBuffer);
-                mRmb->writeLock(writeBuffer);
+                // no copy, and the data vector goes back to the recycler with the message
+                mRmb->writeLock(const_cast<SmallBundle&>(bundle).getMutable<std::vector<T>>(
+                        KEY_ID_DATA));
                 break;
             }
             case WHAT_WRITE_LOOP: {
                 RingBufferManager<T, N>::FUNCTION_WRITE funcWrite;
-                bundle.get(KEY_WRITE, funcWrite);
+                if (!bundle.getSafe(KEY_ID_WRITE, funcWrite)) {
+                    return -EINVAL;
+                }
                 funcWrite();
                 break;
             }
@@ -188,16 +264,19 @@ class RingBufferManager {
 
     class ReadRingHandler : public Handler {
      public:
-         ReadRingHandler(RingBufferManager *rbm) : mRmb(rbm) {
+         ReadRingHandler(RingBufferManager *rbm, std::shared_ptr<Looper> looper)
+                : Handler(looper), mRmb(rbm) {
          }
 
         int32_t onInvoke(const Message &message) override {
-            Bundle &bundle = const_cast<Message&>(message).mBundle;
+            const SmallBundle &bundle = message.mSmallBundle;
             switch (message.mWhat) {
             case WHAT_READ_LOOP: {
                 std::vector<T> readBuffer;
                 RingBufferManager<T, N>::FUNCTION_READ funcRead;
-                bundle.get(KEY_READ, funcRead);
+                if (!bundle.getSafe(KEY_ID_READ, funcRead)) {
+                    return -EINVAL;
+                }
                 mRmb->readLock(readBuffer, message.mArg1/*size*/);
                 funcRead(readBuffer, message.mArg1/*size*/);
                 break;
@@ -217,8 +296,10 @@ class RingBufferManager {
 
  private:
     const std::string mName;
+    std::shared_ptr<Looper> mLooper;
     mutable std::shared_mutex mMutex;
     std::condition_variable_any mConditionVariable;
+    std::atomic_bool mOverwriteOldest { false };
     RingBuffer<T, N> mBuffer;
     std::unique_ptr<WriteRingHandler> mWriteHandler;
     std::unique_ptr<ReadRingHandler> mReadHandler;
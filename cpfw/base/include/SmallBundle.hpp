@@ -0,0 +1,351 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPFW_BASE_INCLUDE_SMALLBUNDLE_HPP_
+#define CPFW_BASE_INCLUDE_SMALLBUNDLE_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+#include "SmallStorage.hpp"
+
+namespace cpfw {
+
+using BundleKey = uint32_t;
+
+/**
+ * @brief intern key name at compile time, FNV-1a.
+ * e.g.: constexpr BundleKey KEY_ID_DATA = internKey("data");
+ * two names hashed to one key would share a slot silently, so where keys are defined,
+ * check the ones which may meet in a bundle with areKeysDistinct.
+ */
+constexpr BundleKey internKey(std::string_view name) {
+    BundleKey hash = 2166136261U;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+// e.g.: static_assert(areKeysDistinct({ KEY_ID_DATA, KEY_ID_SIZE }));
+constexpr bool areKeysDistinct(std::initializer_list<BundleKey> keys) {
+    for (auto left = keys.begin(); left != keys.end(); ++left) {
+        for (auto right = left + 1; right != keys.end(); ++right) {
+            if (*left == *right) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Bundle with integer keys and inline storage.
+ * values up to INLINE_SIZE bytes live in the slots, larger ones are put on heap,
+ * keys beyond SLOT_COUNT go to an overflow bundle on heap.
+ * so a message with a few small values needs no allocation.
+ */
+class SmallBundle {
+ public:
+    static constexpr std::size_t SLOT_COUNT = 4U;
+    static constexpr std::size_t INLINE_SIZE = 32U;
+
+    SmallBundle() = default;
+
+    SmallBundle(const SmallBundle &other) {
+        copyFrom(other);
+    }
+
+    SmallBundle(SmallBundle &&other) noexcept {
+        moveFrom(other);
+    }
+
+    SmallBundle& operator=(const SmallBundle &other) {
+        if (this != &other) {
+            clear();
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    SmallBundle& operator=(SmallBundle &&other) noexcept {
+        if (this != &other) {
+            clear();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    ~SmallBundle() {
+        clear();
+    }
+
+    template<typename TVALUE>
+    void set(const BundleKey key, TVALUE &&value) {
+        using TDecay = std::decay_t<TVALUE>;
+        if (Slot *slot = findAny(key); slot != nullptr) {
+            if (slot->dormant && *slot->ops->type == typeid(TDecay)) {
+                // assign into the kept value, so its capacity is reused
+                *static_cast<TDecay*>(const_cast<void*>(slot->ops->get(slot->storage))) =
+                        std::forward<TVALUE>(value);
+                slot->dormant = false;
+                return;
+            }
+            erase(key);
+        }
+        if (mCount == SLOT_COUNT) {
+            eraseDormant();  // a live value is worth the slot more than kept capacity
+        }
+        if (mCount < SLOT_COUNT) {
+            construct<TDecay>(mSlots[mCount], key, std::forward<TVALUE>(value));
+            ++mCount;
+            return;
+        }
+        if (!mOverflow) {
+            mOverflow = std::make_unique<SmallBundle>();
+        }
+        mOverflow->set(key, std::forward<TVALUE>(value));
+    }
+
+    // no check, need user to ensure it's safety. perf
+    template<typename TVALUE>
+    void get(const BundleKey key, TVALUE &value) const {
+        const Slot *slot = find(key);
+        assert(slot != nullptr);
+        value = *static_cast<const TVALUE*>(slot->ops->get(slot->storage));
+    }
+
+    // not perf, but safe
+    template<typename TVALUE>
+    [[nodiscard]] bool getSafe(const BundleKey key, TVALUE &value) const {
+        if (const Slot *slot = find(key); slot != nullptr) {
+            if (*slot->ops->type == typeid(TVALUE)) {
+                value = *static_cast<const TVALUE*>(slot->ops->get(slot->storage));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // move the value out instead of copying, no check like get
+    template<typename TVALUE>
+    void take(const BundleKey key, TVALUE &value) {
+        Slot *slot = find(key);
+        assert(slot != nullptr);
+        value = std::move(*static_cast<TVALUE*>(
+                const_cast<void*>(slot->ops->get(slot->storage))));
+    }
+
+    /**
+     * @brief get the value to modify in place, e.g. assign a vector reusing its capacity.
+     * a default one is constructed if key is absent or holds another type.
+     */
+    template<typename TVALUE>
+    TVALUE& getMutable(const BundleKey key) {
+        if (Slot *slot = findAny(key); slot != nullptr && *slot->ops->type == typeid(TVALUE)) {
+            slot->dormant = false;
+            return *static_cast<TVALUE*>(const_cast<void*>(slot->ops->get(slot->storage)));
+        }
+        set(key, TVALUE());
+        Slot *slot = find(key);
+        return *static_cast<TVALUE*>(const_cast<void*>(slot->ops->get(slot->storage)));
+    }
+
+    /**
+     * @brief empty every value which has clear(), like containers and strings,
+     * and keep it dormant for reuse. others are erased.
+     * a dormant value is absent to find, get and size, set or getMutable revives it.
+     */
+    void clearValues() {
+        for (std::size_t i=0; i<mCount;) {
+            if (mSlots[i].ops->clear != nullptr) {
+                mSlots[i].ops->clear(mSlots[i].storage);
+                mSlots[i].dormant = true;
+                ++i;
+            } else {
+                erase(mSlots[i].key);  // the last slot is moved to i
+            }
+        }
+        if (mOverflow) {
+            mOverflow->clearValues();
+        }
+    }
+
+    void erase(const BundleKey key) {
+        for (std::size_t i=0; i<mCount; ++i) {
+            if (mSlots[i].key == key) {
+                mSlots[i].ops->destroy(mSlots[i].storage);
+                // keep slots packed
+                if (i != mCount - 1) {
+                    Slot &last = mSlots[mCount - 1];
+                    last.ops->move(mSlots[i].storage, last.storage);
+                    last.ops->destroy(last.storage);
+                    mSlots[i].key = last.key;
+                    mSlots[i].ops = last.ops;
+                    mSlots[i].dormant = last.dormant;
+                }
+                --mCount;
+                return;
+            }
+        }
+        if (mOverflow) {
+            mOverflow->erase(key);
+        }
+    }
+
+    void clear() {
+        for (std::size_t i=0; i<mCount; ++i) {
+            mSlots[i].ops->destroy(mSlots[i].storage);
+        }
+        mCount = 0U;
+        mOverflow.reset();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return liveCount() == 0U && (!mOverflow || mOverflow->empty());
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return liveCount() + (mOverflow ? mOverflow->size() : 0U);
+    }
+
+ private:
+    struct Ops {
+        const std::type_info *type;
+        const void* (*get)(const void *storage);
+        void (*destroy)(void *storage);
+        void (*copy)(void *dst, const void *src);
+        // leaves src valid but moved-from, caller destroys it
+        void (*move)(void *dst, void *src);
+        // nullptr if the type has no clear()
+        void (*clear)(void *storage);
+    };
+
+    struct Slot {
+        BundleKey key;
+        const Ops *ops;
+        bool dormant;  // cleared by clearValues, kept only for the capacity
+        alignas(std::max_align_t) unsigned char storage[INLINE_SIZE];
+    };
+
+    template<typename T>
+    static constexpr bool IS_CLEARABLE = requires(T &value) { value.clear(); };
+
+    template<typename T>
+    struct ValueOps {
+        using Storage = SmallStorage<T, INLINE_SIZE>;
+
+        static const void* get(const void *storage) {
+            return Storage::get(storage);
+        }
+        static void clear(void *storage) {
+            if constexpr (IS_CLEARABLE<T>) {
+                Storage::get(storage)->clear();
+            }
+        }
+        static constexpr Ops OPS { &typeid(T), get, Storage::destroy, Storage::copy,
+                Storage::move, IS_CLEARABLE<T> ? clear : nullptr };
+    };
+
+    template<typename T, typename TVALUE>
+    static void construct(Slot &slot, const BundleKey key, TVALUE &&value) {
+        slot.key = key;
+        slot.dormant = false;
+        SmallStorage<T, INLINE_SIZE>::construct(slot.storage, std::forward<TVALUE>(value));
+        slot.ops = &ValueOps<T>::OPS;
+    }
+
+    Slot* find(const BundleKey key) {
+        return const_cast<Slot*>(std::as_const(*this).find(key));
+    }
+
+    const Slot* find(const BundleKey key) const {
+        for (std::size_t i=0; i<mCount; ++i) {
+            if (mSlots[i].key == key) {
+                return mSlots[i].dormant ? nullptr : &mSlots[i];
+            }
+        }
+        return mOverflow ? mOverflow->find(key) : nullptr;
+    }
+
+    // dormant ones included
+    Slot* findAny(const BundleKey key) {
+        for (std::size_t i=0; i<mCount; ++i) {
+            if (mSlots[i].key == key) {
+                return &mSlots[i];
+            }
+        }
+        return mOverflow ? mOverflow->findAny(key) : nullptr;
+    }
+
+    void eraseDormant() {
+        for (std::size_t i=mCount; i>0; --i) {
+            if (mSlots[i - 1].dormant) {
+                erase(mSlots[i - 1].key);
+            }
+        }
+    }
+
+    std::size_t liveCount() const {
+        std::size_t count = 0U;
+        for (std::size_t i=0; i<mCount; ++i) {
+            count += mSlots[i].dormant ? 0U : 1U;
+        }
+        return count;
+    }
+
+    void copyFrom(const SmallBundle &other) {
+        for (std::size_t i=0; i<other.mCount; ++i) {
+            other.mSlots[i].ops->copy(mSlots[i].storage, other.mSlots[i].storage);
+            mSlots[i].key = other.mSlots[i].key;
+            mSlots[i].ops = other.mSlots[i].ops;
+            mSlots[i].dormant = other.mSlots[i].dormant;
+            mCount = i + 1;
+        }
+        if (other.mOverflow) {
+            mOverflow = std::make_unique<SmallBundle>(*other.mOverflow);
+        }
+    }
+
+    void moveFrom(SmallBundle &other) {
+        for (std::size_t i=0; i<other.mCount; ++i) {
+            other.mSlots[i].ops->move(mSlots[i].storage, other.mSlots[i].storage);
+            mSlots[i].key = other.mSlots[i].key;
+            mSlots[i].ops = other.mSlots[i].ops;
+            mSlots[i].dormant = other.mSlots[i].dormant;
+        }
+        mCount = other.mCount;
+        mOverflow = std::move(other.mOverflow);
+        other.clear();
+    }
+
+ private:
+    Slot mSlots[SLOT_COUNT];
+    std::size_t mCount = 0U;
+    std::unique_ptr<SmallBundle> mOverflow;
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_SMALLBUNDLE_HPP_
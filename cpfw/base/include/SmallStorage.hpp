@@ -0,0 +1,87 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPFW_BASE_INCLUDE_SMALLSTORAGE_HPP_
+#define CPFW_BASE_INCLUDE_SMALLSTORAGE_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cpfw {
+
+/**
+ * @brief keep a T in a buffer of SIZE bytes aligned to std::max_align_t.
+ * it is constructed in place if it fits and moves without throwing,
+ * else the buffer holds a T* owning it on heap.
+ * the type-erased tables of SmallTask and SmallBundle are built from these.
+ */
+template<typename T, std::size_t SIZE>
+struct SmallStorage {
+    static constexpr bool IS_INLINE = sizeof(T) <= SIZE
+            && alignof(T) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<T>;
+
+    template<typename... Args>
+    static void construct(void *storage, Args&&... args) {
+        if constexpr (IS_INLINE) {
+            ::new (storage) T(std::forward<Args>(args)...);
+        } else {
+            ::new (storage) T*(new T(std::forward<Args>(args)...));
+        }
+    }
+
+    static T* get(void *storage) {
+        if constexpr (IS_INLINE) {
+            return std::launder(static_cast<T*>(storage));
+        } else {
+            return *std::launder(static_cast<T**>(storage));
+        }
+    }
+
+    static const T* get(const void *storage) {
+        return get(const_cast<void*>(storage));
+    }
+
+    static void destroy(void *storage) {
+        if constexpr (IS_INLINE) {
+            std::destroy_at(get(storage));
+        } else {
+            delete get(storage);
+        }
+    }
+
+    static void copy(void *dst, const void *src) {
+        construct(dst, *get(src));
+    }
+
+    // leaves src valid but moved-from, caller destroys it
+    static void move(void *dst, void *src) {
+        if constexpr (IS_INLINE) {
+            ::new (dst) T(std::move(*get(src)));
+        } else {
+            ::new (dst) T*(get(src));
+            *std::launder(static_cast<T**>(src)) = nullptr;
+        }
+    }
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_SMALLSTORAGE_HPP_
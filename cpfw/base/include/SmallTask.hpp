@@ -0,0 +1,114 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPFW_BASE_INCLUDE_SMALLTASK_HPP_
+#define CPFW_BASE_INCLUDE_SMALLTASK_HPP_
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "SmallStorage.hpp"
+
+namespace cpfw {
+
+/**
+ * @brief move-only void() callable with inline storage.
+ * callables up to INLINE_SIZE bytes live in it, larger ones are put on heap.
+ * unlike std::function it takes move-only callables, e.g. a lambda owning a promise.
+ */
+class SmallTask {
+ public:
+    static constexpr std::size_t INLINE_SIZE = 56U;
+
+    SmallTask() = default;
+
+    template<class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, SmallTask>>>
+    SmallTask(F &&f) {
+        using TDecay = std::decay_t<F>;
+        SmallStorage<TDecay, INLINE_SIZE>::construct(mStorage, std::forward<F>(f));
+        mOps = &TaskOps<TDecay>::OPS;
+    }
+
+    SmallTask(SmallTask &&other) noexcept {
+        moveFrom(other);
+    }
+
+    SmallTask& operator=(SmallTask &&other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    SmallTask(const SmallTask&) = delete;
+    SmallTask& operator=(const SmallTask&) = delete;
+
+    ~SmallTask() {
+        reset();
+    }
+
+    void operator()() {
+        mOps->invoke(mStorage);
+    }
+
+    explicit operator bool() const {
+        return mOps != nullptr;
+    }
+
+    void reset() {
+        if (mOps != nullptr) {
+            mOps->destroy(mStorage);
+            mOps = nullptr;
+        }
+    }
+
+ private:
+    struct Ops {
+        void (*invoke)(void *storage);
+        void (*destroy)(void *storage);
+        // leaves src moved-from, caller destroys it
+        void (*move)(void *dst, void *src);
+    };
+
+    template<typename T>
+    struct TaskOps {
+        using Storage = SmallStorage<T, INLINE_SIZE>;
+
+        static void invoke(void *storage) {
+            (*Storage::get(storage))();
+        }
+        static constexpr Ops OPS { invoke, Storage::destroy, Storage::move };
+    };
+
+    void moveFrom(SmallTask &other) {
+        if (other.mOps != nullptr) {
+            other.mOps->move(mStorage, other.mStorage);
+            mOps = other.mOps;
+            other.reset();
+        }
+    }
+
+ private:
+    alignas(std::max_align_t) unsigned char mStorage[INLINE_SIZE];
+    const Ops *mOps = nullptr;
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_SMALLTASK_HPP_
@@ -0,0 +1,121 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPFW_BASE_INCLUDE_SPSCRINGBUFFER_HPP_
+#define CPFW_BASE_INCLUDE_SPSCRINGBUFFER_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <vector>
+
+namespace cpfw {
+
+/**
+ * @brief RingBuffer for one producer thread and one consumer thread, no lock and no syscall.
+ * head and tail are atomics on their own cache lines, each side keeps a copy of the other
+ * side's index and loads it again only when the copy says full or empty.
+ * positions only grow, 64 bits do not wrap in practice.
+ */
+template<typename T, int32_t N>
+class SpscRingBuffer {
+    static_assert(N > 0, "N must be positive");
+
+ public:
+    SpscRingBuffer() : mBuffer() {
+    }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    // producer only, all or nothing, -EAGAIN if idle size is not enough
+    int32_t write(const std::vector<T> &writeBuffer) {
+        return write(writeBuffer.data(), writeBuffer.size());
+    }
+
+    int32_t write(const T *data, std::size_t writeSize) {
+        uint64_t tail = mTail.load(std::memory_order_relaxed);
+        if (N - (tail - mCachedHead) < writeSize) {
+            mCachedHead = mHead.load(std::memory_order_acquire);
+            if (N - (tail - mCachedHead) < writeSize) {
+                return -EAGAIN;
+            }
+        }
+
+        std::size_t tailPos = tail % N;
+        std::size_t residualSize = N - tailPos;
+        if (residualSize < writeSize) {
+            std::ranges::copy_n(data, residualSize, mBuffer.begin() + tailPos);
+            std::ranges::copy_n(data + residualSize, writeSize - residualSize, mBuffer.begin());
+        } else {
+            std::ranges::copy_n(data, writeSize, mBuffer.begin() + tailPos);
+        }
+        mTail.store(tail + writeSize, std::memory_order_release);
+        return 0;
+    }
+
+    // consumer only, all or nothing, -EAGAIN if available size is not enough
+    int32_t read(std::vector<T> &readBuffer, std::size_t readSize) {
+        readBuffer.resize(readSize);
+        return read(readBuffer.data(), readSize);
+    }
+
+    int32_t read(T *data, std::size_t readSize) {
+        uint64_t head = mHead.load(std::memory_order_relaxed);
+        if (mCachedTail - head < readSize) {
+            mCachedTail = mTail.load(std::memory_order_acquire);
+            if (mCachedTail - head < readSize) {
+                return -EAGAIN;
+            }
+        }
+
+        std::size_t headPos = head % N;
+        std::size_t residualSize = N - headPos;
+        if (residualSize < readSize) {
+            std::ranges::copy_n(mBuffer.begin() + headPos, residualSize, data);
+            std::ranges::copy_n(mBuffer.begin(), readSize - residualSize, data + residualSize);
+        } else {
+            std::ranges::copy_n(mBuffer.begin() + headPos, readSize, data);
+        }
+        mHead.store(head + readSize, std::memory_order_release);
+        return 0;
+    }
+
+    // a lower bound on the producer thread, a hint on the others
+    int32_t getIdleSize() const {
+        return N - getAvailableSize();
+    }
+
+    // a lower bound on the consumer thread, a hint on the others
+    int32_t getAvailableSize() const {
+        uint64_t head = mHead.load(std::memory_order_acquire);
+        return mTail.load(std::memory_order_acquire) - head;
+    }
+
+ private:
+    alignas(64) std::atomic<uint64_t> mHead { 0U };  // written by the consumer
+    uint64_t mCachedTail = 0U;  // consumer only
+    alignas(64) std::atomic<uint64_t> mTail { 0U };  // written by the producer
+    uint64_t mCachedHead = 0U;  // producer only
+    alignas(64) std::array<T, N> mBuffer;
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_SPSCRINGBUFFER_HPP_
@@ -30,7 +30,8 @@ class State;
 class StateMachine {
  public:
     StateMachine();
-    explicit StateMachine(const std::string &name);
+    // looper to share worker threads with other handlers, nullptr for an own thread
+    explicit StateMachine(const std::string &name, std::shared_ptr<Looper> looper = nullptr);
     ~StateMachine();
 
     const std::string& getName() const;
@@ -50,7 +51,7 @@ class StateMachine {
  private:
     class StateMachineHandler : public Handler {
      public:
-         StateMachineHandler(StateMachine *stateMachine);
+         StateMachineHandler(StateMachine *stateMachine, std::shared_ptr<Looper> looper);
          ~StateMachineHandler();
 
          int32_t onInvoke(const Message &message) override;
@@ -0,0 +1,528 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPFW_BASE_INCLUDE_TASKFUTURE_HPP_
+#define CPFW_BASE_INCLUDE_TASKFUTURE_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "BlockPool.hpp"
+#include "SmallTask.hpp"
+
+namespace cpfw {
+
+// runs tasks, e.g. ThreadPool on its workers
+class Executor {
+ public:
+    virtual ~Executor() = default;
+
+    virtual void execute(SmallTask &&task) = 0;
+};
+
+// runs tasks on the calling thread, for then of futures not made by an executor
+class InlineExecutor : public Executor {
+ public:
+    static InlineExecutor& getInstance() {
+        static InlineExecutor instance;
+        return instance;
+    }
+
+    void execute(SmallTask &&task) override {
+        task();
+    }
+};
+
+// co_await it in a coroutine to go on on a thread of executor
+class ExecutorAwaiter {
+ public:
+    explicit ExecutorAwaiter(Executor &executor) : mExecutor(executor) {
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        mExecutor.execute([handle] {
+            handle.resume();
+        });
+    }
+
+    void await_resume() const noexcept {
+    }
+
+ private:
+    Executor &mExecutor;
+};
+
+template<typename T>
+class TaskFuture;
+
+/**
+ * @brief shared by a TaskFuture and whoever completes it.
+ * callbacks registered by onReady run on the completing thread, so they hand work over to
+ * an Executor or resume a coroutine waiting for it.
+ */
+template<typename T>
+class TaskState {
+ public:
+    using Value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+    explicit TaskState(Executor *executor) : mExecutor(executor) {
+    }
+
+    template<class... V>
+    void setValue(V&&... value) {
+        std::vector<SmallTask> callbacks;
+        {
+            std::lock_guard<std::mutex> lock { mLock };
+            mValue.emplace(std::forward<V>(value)...);
+            callbacks = readyWithLock();
+        }
+        complete(callbacks);
+    }
+
+    void setError(std::exception_ptr error) {
+        std::vector<SmallTask> callbacks;
+        {
+            std::lock_guard<std::mutex> lock { mLock };
+            mError = error;
+            callbacks = readyWithLock();
+        }
+        complete(callbacks);
+    }
+
+    bool isReady() const {
+        return mReady.load(std::memory_order_acquire);
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock { mLock };
+        mCv.wait(lock, [this] { return mReady.load(std::memory_order_relaxed); });
+    }
+
+    // run callback once ready, right now if it is
+    void onReady(SmallTask &&callback) {
+        {
+            std::lock_guard<std::mutex> lock { mLock };
+            if (!mReady.load(std::memory_order_relaxed)) {
+                mCallbacks.push_back(std::move(callback));
+                return;
+            }
+        }
+        callback();
+    }
+
+    // move the value out or rethrow, only when ready
+    Value take() {
+        if (mError) {
+            std::rethrow_exception(mError);
+        }
+        return std::move(*mValue);
+    }
+
+    Executor* getExecutor() const {
+        return mExecutor;
+    }
+
+ private:
+    std::vector<SmallTask> readyWithLock() {
+        mReady.store(true, std::memory_order_release);
+        return std::move(mCallbacks);
+    }
+
+    void complete(std::vector<SmallTask> &callbacks) {
+        mCv.notify_all();
+        for (auto &callback : callbacks) {
+            callback();
+        }
+    }
+
+ private:
+    std::mutex mLock;
+    std::condition_variable mCv;
+    std::atomic_bool mReady { false };
+    std::optional<Value> mValue;
+    std::exception_ptr mError;
+    std::vector<SmallTask> mCallbacks;  // guarded by mLock
+    Executor *mExecutor;  // for then without an executor
+};
+
+template<typename T>
+std::shared_ptr<TaskState<T>> makeTaskState(Executor *executor) {
+    return std::allocate_shared<TaskState<T>>(PoolAllocator<TaskState<T>>(), executor);
+}
+
+// set the result of fn, or what it throws
+template<typename T, class F>
+void completeTaskState(TaskState<T> &state, F &&fn) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            fn();
+            state.setValue();
+        } else {
+            state.setValue(fn());
+        }
+    } catch (...) {
+        state.setError(std::current_exception());
+    }
+}
+
+/**
+ * @brief keep owner alive until state is ready or dropped.
+ * the combinators hold their inputs in owner and the inputs call back with a weak_ptr of
+ * it, so an input which never completes leaks nothing once the combined future is dropped.
+ */
+template<typename T, typename O>
+void keepUntilReady(TaskState<T> &state, std::shared_ptr<O> owner) {
+    state.onReady([owner = std::move(owner)] {
+    });
+}
+
+// return_value or return_void of the promise of a TaskFuture coroutine
+template<typename T>
+class TaskPromiseBase {
+ public:
+    template<class V>
+    void return_value(V &&value) {
+        mState->setValue(std::forward<V>(value));
+    }
+
+ protected:
+    std::shared_ptr<TaskState<T>> mState = makeTaskState<T>(&InlineExecutor::getInstance());
+};
+
+template<>
+class TaskPromiseBase<void> {
+ public:
+    void return_void() {
+        mState->setValue();
+    }
+
+ protected:
+    std::shared_ptr<TaskState<void>> mState =
+            makeTaskState<void>(&InlineExecutor::getInstance());
+};
+
+template<typename T>
+struct WhenAnyResult {
+    std::size_t index;  // of the first ready one
+    std::vector<TaskFuture<T>> futures;
+};
+
+/**
+ * @brief move-only future whose continuations are posted to an executor when it is ready,
+ * so no thread blocks to chain work.
+ * get, then and co_await consume it, valid() is false after.
+ * it is the return type of coroutines too, they start at once and the future is ready
+ * when they return, then of it runs on the thread the coroutine ends on.
+ */
+template<typename T>
+class TaskFuture {
+ public:
+    class promise_type : public TaskPromiseBase<T> {
+     public:
+        TaskFuture get_return_object() {
+            return TaskFuture(this->mState);
+        }
+
+        std::suspend_never initial_suspend() const noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept {
+            return {};
+        }
+
+        void unhandled_exception() {
+            this->mState->setError(std::current_exception());
+        }
+    };
+
+    TaskFuture() = default;
+
+    explicit TaskFuture(std::shared_ptr<TaskState<T>> state) : mState(std::move(state)) {
+    }
+
+    TaskFuture(TaskFuture&&) noexcept = default;
+    TaskFuture& operator=(TaskFuture&&) noexcept = default;
+    TaskFuture(const TaskFuture&) = delete;
+    TaskFuture& operator=(const TaskFuture&) = delete;
+
+    bool valid() const {
+        return mState != nullptr;
+    }
+
+    bool isReady() const {
+        return mState->isReady();
+    }
+
+    void wait() const {
+        mState->wait();
+    }
+
+    // wait, then the value or rethrow what the task threw
+    T get() {
+        std::shared_ptr<TaskState<T>> state = std::move(mState);
+        state->wait();
+        if constexpr (std::is_void_v<T>) {
+            state->take();
+        } else {
+            return state->take();
+        }
+    }
+
+    /**
+     * @brief suspend until ready, then go on on the completing thread, no suspension if ready.
+     * e.g.: int32_t n = co_await pool.submit(count); goes on on the worker that ran count.
+     */
+    auto operator co_await() {
+        return Awaiter { std::move(mState) };
+    }
+
+    /**
+     * @brief run f on the executor of this future once it is ready.
+     * f takes the value, nothing if T is void, and an exception of this future skips f
+     * and goes on to the returned one. or f takes the ready TaskFuture<T> to see errors.
+     */
+    template<class F>
+    auto then(F &&f) {
+        Executor *executor = mState->getExecutor();
+        return then(*executor, std::forward<F>(f));
+    }
+
+    template<class F>
+    auto then(Executor &executor, F &&f) {
+        using RetType = typename ContinuationResult<F>::type;
+        auto next = makeTaskState<RetType>(&executor);
+        std::shared_ptr<TaskState<T>> source = std::move(mState);
+        TaskState<T> &sourceRef = *source;
+        sourceRef.onReady([source = std::move(source), next, &executor,
+                f = std::forward<F>(f)]() mutable {
+            executor.execute([source = std::move(source), next = std::move(next),
+                    f = std::move(f)]() mutable {
+                runContinuation(std::move(source), *next, f);
+            });
+        });
+        return TaskFuture<RetType>(std::move(next));
+    }
+
+ private:
+    struct Awaiter {
+        bool await_ready() const {
+            return state->isReady();
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            // may resume at once, which destroys this awaiter
+            std::shared_ptr<TaskState<T>> keep = state;
+            keep->onReady([handle] {
+                handle.resume();
+            });
+        }
+
+        T await_resume() {
+            if constexpr (std::is_void_v<T>) {
+                state->take();
+            } else {
+                return state->take();
+            }
+        }
+
+        std::shared_ptr<TaskState<T>> state;
+    };
+
+    template<class F>
+    struct ContinuationResult {
+        static auto deduce() {
+            if constexpr (std::is_invocable_v<F&, TaskFuture<T>&&>) {
+                return std::type_identity<std::invoke_result_t<F&, TaskFuture<T>&&>>();
+            } else if constexpr (std::is_void_v<T>) {
+                return std::type_identity<std::invoke_result_t<F&>>();
+            } else {
+                return std::type_identity<std::invoke_result_t<F&, T&&>>();
+            }
+        }
+        using type = typename decltype(deduce())::type;
+    };
+
+    template<typename R, class F>
+    static void runContinuation(std::shared_ptr<TaskState<T>> &&source, TaskState<R> &next,
+            F &f) {
+        if constexpr (std::is_invocable_v<F&, TaskFuture<T>&&>) {
+            completeTaskState(next, [&] {
+                return f(TaskFuture<T>(std::move(source)));
+            });
+        } else {
+            completeTaskState(next, [&] {
+                if constexpr (std::is_void_v<T>) {
+                    source->take();
+                    return f();
+                } else {
+                    return f(source->take());
+                }
+            });
+        }
+    }
+
+    template<typename U>
+    friend class TaskFuture;
+
+    template<typename U>
+    friend TaskFuture<std::vector<TaskFuture<U>>> whenAll(std::vector<TaskFuture<U>> &&futures);
+
+    template<typename... Us>
+    friend TaskFuture<std::tuple<TaskFuture<Us>...>> whenAll(TaskFuture<Us>&&... futures);
+
+    template<typename U>
+    friend TaskFuture<WhenAnyResult<U>> whenAny(std::vector<TaskFuture<U>> &&futures);
+
+ private:
+    std::shared_ptr<TaskState<T>> mState;
+};
+
+/**
+ * @brief ready when all of futures are, with them all ready inside.
+ * continuations of it run on the executor of the first one.
+ */
+template<typename T>
+TaskFuture<std::vector<TaskFuture<T>>> whenAll(std::vector<TaskFuture<T>> &&futures) {
+    using Result = std::vector<TaskFuture<T>>;
+    struct AllState {
+        std::atomic<std::size_t> remaining;
+        Result futures;
+        std::weak_ptr<TaskState<Result>> result;
+    };
+
+    Executor *executor = futures.empty()
+            ? &InlineExecutor::getInstance() : futures.front().mState->getExecutor();
+    auto result = makeTaskState<Result>(executor);
+    if (futures.empty()) {
+        result->setValue(Result());
+        return TaskFuture<Result>(std::move(result));
+    }
+
+    // a ready one runs its callback at once, so do not touch all->futures in the loop
+    std::vector<std::shared_ptr<TaskState<T>>> states;
+    for (auto &future : futures) {
+        states.push_back(future.mState);
+    }
+    auto all = std::make_shared<AllState>();
+    all->remaining = futures.size();
+    all->futures = std::move(futures);
+    all->result = result;
+    keepUntilReady(*result, all);
+    for (auto &state : states) {
+        state->onReady([weak = std::weak_ptr<AllState>(all)] {
+            std::shared_ptr<AllState> all = weak.lock();
+            if (all && 1U == all->remaining.fetch_sub(1U, std::memory_order_acq_rel)) {
+                if (auto result = all->result.lock()) {
+                    result->setValue(std::move(all->futures));
+                }
+            }
+        });
+    }
+    return TaskFuture<Result>(std::move(result));
+}
+
+// as above for futures of different types
+template<typename... Ts>
+TaskFuture<std::tuple<TaskFuture<Ts>...>> whenAll(TaskFuture<Ts>&&... futures) {
+    static_assert(sizeof...(Ts) > 0U, "no future to wait for");
+    using Result = std::tuple<TaskFuture<Ts>...>;
+    struct AllState {
+        std::atomic<std::size_t> remaining { sizeof...(Ts) };
+        Result futures;
+        std::weak_ptr<TaskState<Result>> result;
+    };
+
+    Executor *executor = std::get<0>(std::forward_as_tuple(futures...)).mState->getExecutor();
+    auto result = makeTaskState<Result>(executor);
+    auto states = std::make_tuple(futures.mState...);
+    auto all = std::make_shared<AllState>();
+    all->futures = Result(std::move(futures)...);
+    all->result = result;
+    keepUntilReady(*result, all);
+    std::apply([weak = std::weak_ptr<AllState>(all)](auto&... state) {
+        (state->onReady([weak] {
+            std::shared_ptr<AllState> all = weak.lock();
+            if (all && 1U == all->remaining.fetch_sub(1U, std::memory_order_acq_rel)) {
+                if (auto result = all->result.lock()) {
+                    result->setValue(std::move(all->futures));
+                }
+            }
+        }), ...);
+    }, states);
+    return TaskFuture<Result>(std::move(result));
+}
+
+/**
+ * @brief ready when one of futures is, with its index and all of them inside.
+ * ready at once with index 0 and no future if futures is empty.
+ */
+template<typename T>
+TaskFuture<WhenAnyResult<T>> whenAny(std::vector<TaskFuture<T>> &&futures) {
+    using Result = WhenAnyResult<T>;
+    struct AnyState {
+        std::atomic_bool done { false };
+        std::vector<TaskFuture<T>> futures;
+        std::weak_ptr<TaskState<Result>> result;
+    };
+
+    Executor *executor = futures.empty()
+            ? &InlineExecutor::getInstance() : futures.front().mState->getExecutor();
+    auto result = makeTaskState<Result>(executor);
+    if (futures.empty()) {
+        result->setValue(Result { 0U, {} });
+        return TaskFuture<Result>(std::move(result));
+    }
+
+    std::vector<std::shared_ptr<TaskState<T>>> states;
+    for (auto &future : futures) {
+        states.push_back(future.mState);
+    }
+    auto any = std::make_shared<AnyState>();
+    any->futures = std::move(futures);
+    any->result = result;
+    keepUntilReady(*result, any);
+    for (std::size_t i=0; i<states.size(); ++i) {
+        states[i]->onReady([weak = std::weak_ptr<AnyState>(any), i] {
+            std::shared_ptr<AnyState> any = weak.lock();
+            if (any && !any->done.exchange(true, std::memory_order_acq_rel)) {
+                if (auto result = any->result.lock()) {
+                    result->setValue(Result { i, std::move(any->futures) });
+                }
+            }
+        });
+    }
+    return TaskFuture<Result>(std::move(result));
+}
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_TASKFUTURE_HPP_
@@ -16,104 +16,1031 @@
 #ifndef CPFW_BASE_INCLUDE_THREADPOOL_HPP_
 #define CPFW_BASE_INCLUDE_THREADPOOL_HPP_
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <future>
-#include <queue>
+#include <memory>
+#include <mutex>
+#include <ranges>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
+#include "BlockPool.hpp"
+#include "CpuTopology.h"
+#include "Histogram.h"
+#include "SmallTask.hpp"
+#include "TaskFuture.hpp"
+#include "TimeUtils.h"
+#include "WorkStealingDeque.hpp"
+
 namespace cpfw {
 
 namespace {
-    const uint8_t MAX_THREAD_COUNT = 16U;
+    // rounds of looking for a task before a worker parks
+    const uint32_t SPIN_COUNT = 64U;
 }
 
-class ThreadPool {
+enum class TaskPriority : uint8_t {
+    HIGH,
+    NORMAL,
+    LOW,
+};
+
+enum class TaskLane : uint8_t {
+    HIGH,
+    DEADLINE,  // earliest deadline first
+    NORMAL,
+    LOW,
+};
+
+constexpr std::size_t TASK_LANE_COUNT = 4U;
+
+struct TaskLaneStats {
+    uint64_t submitCount = 0U;
+    std::size_t queueDepth = 0U;  // counted even if disabled
+    std::size_t maxQueueDepth = 0U;  // high-water mark
+    uint64_t agedCount = 0U;  // run ahead of higher lanes for waiting too long
+    uint64_t lateCount = 0U;  // DEADLINE lane only, started after the deadline
+    Histogram waitNs;  // from submit to start
+};
+
+struct ThreadPoolStats {
+    std::array<TaskLaneStats, TASK_LANE_COUNT> lanes;  // indexed by TaskLane
+    uint32_t threadCount = 0U;
+    uint64_t addedThreadCount = 0U;  // by an elastic pool, counted even if disabled
+    uint64_t retiredThreadCount = 0U;  // as above
+};
+
+/**
+ * @brief work-stealing thread pool.
+ * each worker owns a deque, tasks committed by a worker go to its own deque and are
+ * run newest first, which keeps fan-out hot in cache.
+ * tasks committed by other threads go to the injection queue of a node.
+ * a worker out of tasks looks at its node first: injection queue, then steals the oldest
+ * task of a worker in the node. other nodes after that. then it spins a while and parks
+ * until a task is committed.
+ * workers are in one node unless Config::numaAware.
+ * tasks and the shared states of futures are in pooled blocks, post skips the future.
+ * batches are queued under one lock, parallelFor and parallelReduce are built on them.
+ *
+ * tasks are NORMAL unless TaskOptions says otherwise. other lanes are queued in the node,
+ * and a worker takes HIGH, then DEADLINE tasks before its own deque and the NORMAL and LOW
+ * lanes. against starvation, the head of NORMAL or LOW goes first once higher lanes held it
+ * back for Config::agingThreshold, and a worker runs one of its own tasks after Config::urgentBurst
+ * HIGH or DEADLINE ones in a row.
+ *
+ * the pool is elastic if Config::maxThreadCount is above Config::threadCount. a thread is added
+ * when no thread is idle and a task waited longer than Config::growThreshold, checked when a
+ * task is submitted to a node or started, at most one per growThreshold. a thread above
+ * threadCount exits once it parked for Config::idleTimeout.
+ */
+class ThreadPool : public Executor {
  public:
-    ThreadPool(uint8_t size = 4U) {
-        initThreadPool(size);
+    static constexpr uint32_t ANY_NODE = UINT32_MAX;
+
+    struct Config {
+        uint32_t threadCount = 0U;  // 0 for std::thread::hardware_concurrency(), the minimum
+        uint32_t maxThreadCount = 0U;  // above threadCount for an elastic pool
+        bool pinThreads = false;  // pin each worker to a cpu, of its node if numaAware
+        bool numaAware = false;  // a node per NUMA node, workers spread over them in turn
+        std::chrono::nanoseconds agingThreshold = std::chrono::milliseconds(10);
+        uint32_t urgentBurst = 16U;
+        std::chrono::nanoseconds growThreshold = std::chrono::milliseconds(1);
+        std::chrono::nanoseconds idleTimeout = std::chrono::seconds(10);
+    };
+
+    struct TaskOptions {
+        TaskPriority priority = TaskPriority::NORMAL;
+        // set for the DEADLINE lane, priority is ignored then. a task past its deadline still runs
+        std::chrono::steady_clock::time_point deadline {};
+        uint32_t node = ANY_NODE;
+    };
+
+    ThreadPool(uint32_t size = std::thread::hardware_concurrency())
+            : ThreadPool(Config { size }) {
+    }
+
+    explicit ThreadPool(const Config &config)
+            : mAgingNs(config.agingThreshold.count()), mUrgentBurst(config.urgentBurst),
+              mGrowNs(config.growThreshold.count()), mIdleTimeout(config.idleTimeout) {
+        initThreadPool(config);
     }
 
     ~ThreadPool() {
-        mIsRunning = false;
+        {
+            std::lock_guard<std::mutex> lock { mLock };
+            mIsRunning = false;
+        }
         mCv.notify_all();
-        for (std::thread& thrd : mThreadPool) {
-            if (thrd.joinable()) {
-                thrd.join();
-             }
+        // workers run up the tasks left before exit, no thread is added after
+        std::lock_guard<std::mutex> lock { mResizeLock };
+        for (auto &worker : mWorkers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
         }
     }
 
     template<class F, class... Args>
     auto commit(F&& f, Args&&... args) -> std::future<decltype(f(args...))> {
+        return commitOnNode(ANY_NODE, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief commit to the injection queue of a node, so it is run by a worker of the node
+     * unless the others are idle and steal it.
+     *
+     * @param node index in [0, getNodeCount()), not the NUMA node id. ANY_NODE same as commit.
+     */
+    template<class F, class... Args>
+    auto commitOnNode(uint32_t node, F&& f, Args&&... args)
+            -> std::future<decltype(f(args...))> {
+        return commit(TaskOptions { TaskPriority::NORMAL, {}, node },
+                std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    // with a priority lane, a deadline or a node
+    template<class F, class... Args>
+    auto commit(const TaskOptions &options, F&& f, Args&&... args)
+            -> std::future<decltype(f(args...))> {
         using RetType = decltype(f(args...));
-        auto task = std::make_shared<std::packaged_task<RetType()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-        );
-        std::future<RetType> future = task->get_future();
-        {
-            std::lock_guard<std::mutex> lock { mLock };
-            mTaskPool.emplace([task]() {
-                (*task)();
-            });
+        // the shared state comes from the block pool too
+        std::promise<RetType> promise { std::allocator_arg, PoolAllocator<RetType>() };
+        std::future<RetType> future = promise.get_future();
+        if constexpr (sizeof...(Args) == 0U) {
+            enqueue(newPromiseTask(std::move(promise), std::forward<F>(f)), options);
+        } else {
+            enqueue(newPromiseTask(std::move(promise), [f = std::forward<F>(f),
+                    ...args = std::forward<Args>(args)]() mutable {
+                return std::invoke(f, args...);
+            }), options);
         }
-        mCv.notify_one();
 
         return future;
     }
 
-    uint8_t getIdleThreadCount() {
+    /**
+     * @brief like commit, with a TaskFuture to chain continuations on instead of blocking.
+     * e.g.: pool.submit(load).then(parse).then([](Doc doc) { ... });
+     * continuations run on this pool unless another executor is given to then.
+     */
+    template<class F, class... Args>
+            requires (!std::is_same_v<std::decay_t<F>, TaskOptions>)
+    auto submit(F&& f, Args&&... args) -> TaskFuture<std::invoke_result_t<F&, Args&...>> {
+        return submit(TaskOptions {}, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    template<class F, class... Args>
+    auto submit(const TaskOptions &options, F&& f, Args&&... args)
+            -> TaskFuture<std::invoke_result_t<F&, Args&...>> {
+        using RetType = std::invoke_result_t<F&, Args&...>;
+        auto state = makeTaskState<RetType>(this);
+        enqueue(newTask([state, f = std::forward<F>(f),
+                ...args = std::forward<Args>(args)]() mutable {
+            completeTaskState(*state, [&] {
+                return std::invoke(f, args...);
+            });
+        }), options);
+        return TaskFuture<RetType>(std::move(state));
+    }
+
+    // co_await it in a coroutine to go on on a worker
+    ExecutorAwaiter schedule() {
+        return ExecutorAwaiter(*this);
+    }
+
+    // for continuations of TaskFuture
+    void execute(SmallTask &&task) override {
+        enqueue(newTask(std::move(task)), TaskOptions {});
+    }
+
+    /**
+     * @brief fire and forget, no future to allocate and wait on.
+     * f must not throw, there is nobody to take it.
+     */
+    template<class F, class... Args>
+            requires (!std::is_same_v<std::decay_t<F>, TaskOptions>)
+    void post(F&& f, Args&&... args) {
+        post(TaskOptions {}, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    template<class F, class... Args>
+    void postOnNode(uint32_t node, F&& f, Args&&... args) {
+        post(TaskOptions { TaskPriority::NORMAL, {}, node },
+                std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    template<class F, class... Args>
+    void post(const TaskOptions &options, F&& f, Args&&... args) {
+        if constexpr (sizeof...(Args) == 0U) {
+            enqueue(newTask(std::forward<F>(f)), options);
+        } else {
+            enqueue(newTask([f = std::forward<F>(f), ...args = std::forward<Args>(args)]() mutable {
+                std::invoke(f, args...);
+            }), options);
+        }
+    }
+
+    /**
+     * @brief commit every callable of the range, they take no arguments.
+     * tasks are queued under one lock and parked workers are woken at once,
+     * instead of a lock and a notify per commit.
+     */
+    template<class RANGE>
+    auto commitBatch(RANGE &&range, uint32_t node = ANY_NODE)
+            -> std::vector<std::future<std::invoke_result_t<std::ranges::range_value_t<RANGE>&>>> {
+        using RetType = std::invoke_result_t<std::ranges::range_value_t<RANGE>&>;
+        std::vector<std::future<RetType>> futures;
+        std::vector<Task*> tasks;
+        if constexpr (std::ranges::sized_range<RANGE>) {
+            futures.reserve(std::ranges::size(range));
+            tasks.reserve(std::ranges::size(range));
+        }
+        for (auto &&f : range) {
+            std::promise<RetType> promise { std::allocator_arg, PoolAllocator<RetType>() };
+            futures.push_back(promise.get_future());
+            tasks.push_back(newPromiseTask(std::move(promise), forwardElement<RANGE>(f)));
+        }
+        enqueue(tasks.data(), tasks.size(), node);
+        return futures;
+    }
+
+    // like commitBatch without futures
+    template<class RANGE>
+    void postBatch(RANGE &&range, uint32_t node = ANY_NODE) {
+        std::vector<Task*> tasks;
+        if constexpr (std::ranges::sized_range<RANGE>) {
+            tasks.reserve(std::ranges::size(range));
+        }
+        for (auto &&f : range) {
+            tasks.push_back(newTask(forwardElement<RANGE>(f)));
+        }
+        enqueue(tasks.data(), tasks.size(), node);
+    }
+
+    /**
+     * @brief call fn(i) for i in [begin, end), and return when all are done.
+     * the range is cut into chunks of grain indexes, 0 for about 4 chunks per worker.
+     * the caller runs chunks too, so it is fine to call it from a task of the pool.
+     * fn must not throw.
+     */
+    template<class Index, class F>
+    void parallelFor(Index begin, Index end, std::size_t grain, F &&fn) {
+        forEachChunk(begin, end, grain, [&fn](std::size_t, Index first, Index last) {
+            for (Index i=first; i<last; ++i) {
+                fn(i);
+            }
+        });
+    }
+
+    /**
+     * @brief reduce(... reduce(reduce(identity, fn(begin)), fn(begin + 1)) ..., fn(end - 1)).
+     * chunks are reduced in parallel, then their results in index order, so reduce needs to
+     * be associative but not commutative. chunking is as parallelFor.
+     */
+    template<class Index, class T, class F, class R>
+    T parallelReduce(Index begin, Index end, std::size_t grain, T identity, F &&fn, R &&reduce) {
+        if (end <= begin) {
+            return identity;
+        }
+        struct Partial {
+            T value;
+        };
+        std::vector<Partial> partials(chunkCount(end - begin, resolveGrain(end - begin, grain)),
+                Partial { identity });
+        forEachChunk(begin, end, grain,
+                [&fn, &reduce, &partials](std::size_t index, Index first, Index last) {
+            T value = partials[index].value;
+            for (Index i=first; i<last; ++i) {
+                value = reduce(std::move(value), fn(i));
+            }
+            partials[index].value = std::move(value);
+        });
+
+        T result = std::move(identity);
+        for (auto &partial : partials) {
+            result = reduce(std::move(result), std::move(partial.value));
+        }
+        return result;
+    }
+
+    uint32_t getIdleThreadCount() {
         return mIdleThreadCount;
     }
 
-    uint8_t getThreadCount() {
-        return mThreadPool.size();
+    // running now, varies if elastic
+    uint32_t getThreadCount() {
+        return mThreadCount;
+    }
+
+    uint32_t getNodeCount() {
+        return mNodes.size();
+    }
+
+    /**
+     * @brief record wait time of every task and the lane depth high-water marks, off by default.
+     * costs a clock read and a few atomics per task.
+     */
+    void setStatsEnabled(bool enable) {
+        mStatsEnabled = enable;
+    }
+
+    // snapshot, the queue depths are counted even if disabled
+    ThreadPoolStats getStats() {
+        ThreadPoolStats stats;
+        stats.threadCount = mThreadCount;
+        stats.addedThreadCount = mAddedThreadCount;
+        stats.retiredThreadCount = mRetiredThreadCount;
+        for (std::size_t lane=0; lane<TASK_LANE_COUNT; ++lane) {
+            stats.lanes[lane].submitCount = mLaneCounters[lane].submitCount;
+            stats.lanes[lane].maxQueueDepth = mLaneCounters[lane].maxDepth;
+        }
+        for (auto &worker : mWorkers) {
+            std::lock_guard<std::mutex> lock { worker->statsLock };
+            for (std::size_t lane=0; lane<TASK_LANE_COUNT; ++lane) {
+                stats.lanes[lane].agedCount += worker->stats[lane].agedCount;
+                stats.lanes[lane].lateCount += worker->stats[lane].lateCount;
+                stats.lanes[lane].waitNs.merge(worker->stats[lane].waitNs);
+            }
+            stats.lanes[laneIndex(TaskLane::NORMAL)].queueDepth += worker->deque.size();
+        }
+        for (auto &node : mNodes) {
+            std::lock_guard<std::mutex> lock { node->lock };
+            for (std::size_t lane=0; lane<TASK_LANE_COUNT; ++lane) {
+                stats.lanes[lane].queueDepth += node->fifos[lane].size();
+            }
+            stats.lanes[laneIndex(TaskLane::DEADLINE)].queueDepth += node->deadlines.size();
+        }
+        return stats;
+    }
+
+    void resetStats() {
+        mAddedThreadCount = 0U;
+        mRetiredThreadCount = 0U;
+        for (auto &counters : mLaneCounters) {
+            counters.submitCount = 0U;
+            counters.maxDepth = std::max<int64_t>(counters.depth.load(), 0);
+        }
+        for (auto &worker : mWorkers) {
+            std::lock_guard<std::mutex> lock { worker->statsLock };
+            worker->stats = {};
+        }
     }
 
  private:
-    void initThreadPool(uint8_t size) {
-        for (; mThreadPool.size() < MAX_THREAD_COUNT && size > 0; --size) {
-            mThreadPool.emplace_back([this] {
-                while (true) {
-                    Task task;
-                    {
-                        std::unique_lock<std::mutex> lock { mLock };
-                        mCv.wait(lock, [this] {
-                            return !mIsRunning || !mTaskPool.empty();
-                        });
-                        if (!mIsRunning && mTaskPool.empty()) {
-                            return;
-                        }
-                        --mIdleThreadCount;
-                        task = std::move(mTaskPool.front());
-                        mTaskPool.pop();
+    static constexpr uint32_t NO_CPU = UINT32_MAX;
+
+    // the queues hold pointers to them, so a task is built in place in a pooled block
+    struct Task {
+        template<class F>
+        explicit Task(F &&f) : function(std::forward<F>(f)) {
+        }
+
+        SmallTask function;
+        uint64_t submitNs = 0U;  // for stats or an elastic pool
+        uint64_t blockedNs = 0U;  // since when a higher lane holds it back as a head, for aging
+        uint64_t deadlineNs = 0U;
+        TaskLane lane = TaskLane::NORMAL;
+        bool counted = false;  // in the lane depth of stats
+        bool aged = false;
+    };
+    using TaskPool = BlockPool<sizeof(Task)>;
+
+    struct LaneCounters {
+        std::atomic<uint64_t> submitCount { 0U };
+        std::atomic<int64_t> depth { 0 };  // counted tasks only
+        std::atomic<std::size_t> maxDepth { 0U };
+    };
+
+    // taken by a worker, guarded by its statsLock
+    struct WorkerLaneStats {
+        uint64_t agedCount = 0U;
+        uint64_t lateCount = 0U;
+        Histogram waitNs;
+    };
+
+    struct DeadlineEntry {
+        uint64_t deadlineNs;
+        uint64_t sequence;
+        Task *task;
+
+        // for a min heap by std::push_heap
+        bool operator<(const DeadlineEntry &other) const {
+            if (deadlineNs != other.deadlineNs) {
+                return deadlineNs > other.deadlineNs;
+            }
+            return sequence > other.sequence;
+        }
+    };
+
+    static constexpr std::size_t laneIndex(const TaskLane lane) {
+        return static_cast<std::size_t>(lane);
+    }
+
+    static bool isUrgent(const TaskLane lane) {
+        return lane == TaskLane::HIGH || lane == TaskLane::DEADLINE;
+    }
+
+    template<class F>
+    static Task* newTask(F &&f) {
+        return ::new (TaskPool::allocate()) Task(std::forward<F>(f));
+    }
+
+    // the result or the exception of f goes to promise
+    template<class RetType, class F>
+    static Task* newPromiseTask(std::promise<RetType> &&promise, F &&f) {
+        return newTask([promise = std::move(promise), f = std::forward<F>(f)]() mutable {
+            try {
+                if constexpr (std::is_void_v<RetType>) {
+                    f();
+                    promise.set_value();
+                } else {
+                    promise.set_value(f());
+                }
+            } catch (...) {
+                promise.set_exception(std::current_exception());
+            }
+        });
+    }
+
+    // elements of an rvalue range are moved, others copied
+    template<class RANGE, class T>
+    static decltype(auto) forwardElement(T &element) {
+        if constexpr (std::is_lvalue_reference_v<RANGE>) {
+            return static_cast<const T&>(element);
+        } else {
+            return std::move(element);
+        }
+    }
+
+    static void deleteTask(Task *task) {
+        std::destroy_at(task);
+        TaskPool::deallocate(task);
+    }
+
+    struct Worker {
+        WorkStealingDeque<Task*> deque;
+        std::thread thread;
+        uint32_t node = 0U;
+        uint32_t cpu = NO_CPU;
+        uint32_t urgentRun = 0U;  // HIGH and DEADLINE tasks run in a row
+        std::atomic_bool active { false };  // has a thread, cleared by the thread on exit
+        std::mutex statsLock;
+        std::array<WorkerLaneStats, TASK_LANE_COUNT> stats;
+    };
+
+    // the injection queues of a node, one per lane
+    struct Node {
+        std::mutex lock;
+        // guarded by lock, indexed by TaskLane, the DEADLINE one is unused for deadlines
+        std::array<std::deque<Task*>, TASK_LANE_COUNT> fifos;
+        std::vector<DeadlineEntry> deadlines;  // guarded by lock
+        uint64_t sequence = 0U;  // guarded by lock
+        std::atomic<std::size_t> injectionSize { 0U };  // of all lanes
+        std::atomic<std::size_t> urgentSize { 0U };  // of HIGH and DEADLINE
+        // when the head of NORMAL or LOW gets aged, UINT64_MAX if both are empty
+        std::atomic<uint64_t> agedAtNs { UINT64_MAX };
+        std::vector<uint32_t> workers;
+    };
+
+    void initThreadPool(const Config &config) {
+        uint32_t minCount = config.threadCount > 0U
+                ? config.threadCount : std::max(1U, std::thread::hardware_concurrency());
+        // a worker per thread it may have, so thieves never see mWorkers change
+        uint32_t count = std::max(minCount, config.maxThreadCount);
+        mMinThreadCount = minCount;
+        mElastic = count > minCount;
+
+        std::vector<NumaNode> numaNodes;
+        if (config.numaAware) {
+            numaNodes = getNumaNodes();
+        } else if (config.pinThreads) {
+            // all cpus in one node
+            numaNodes.push_back({ 0U, {} });
+            for (auto &numaNode : getNumaNodes()) {
+                numaNodes[0].cpus.insert(numaNodes[0].cpus.end(),
+                        numaNode.cpus.begin(), numaNode.cpus.end());
+            }
+        } else {
+            numaNodes.push_back({ 0U, {} });
+        }
+
+        for (std::size_t i=0; i<numaNodes.size(); ++i) {
+            mNodes.push_back(std::make_unique<Node>());
+        }
+        for (uint32_t i=0; i<count; ++i) {
+            auto worker = std::make_unique<Worker>();
+            worker->node = i % numaNodes.size();
+            const std::vector<uint32_t> &cpus = numaNodes[worker->node].cpus;
+            if (config.pinThreads && !cpus.empty()) {
+                worker->cpu = cpus[(i / numaNodes.size()) % cpus.size()];
+            }
+            mNodes[worker->node]->workers.push_back(i);
+            mWorkers.push_back(std::move(worker));
+        }
+
+        // all deques exist before any worker may steal
+        mThreadCount = minCount;
+        mIdleThreadCount = minCount;
+        for (uint32_t i=0; i<minCount; ++i) {
+            startWorker(i);
+        }
+    }
+
+    void startWorker(const uint32_t index) {
+        mWorkers[index]->active.store(true, std::memory_order_relaxed);
+        mWorkers[index]->thread = std::thread([this, index] {
+            if (mWorkers[index]->cpu != NO_CPU) {
+                pinCurrentThread(mWorkers[index]->cpu);
+            }
+            run(index);
+        });
+    }
+
+    // add a thread if none is idle and a task waited too long, at most one per mGrowNs
+    void growIfWaiting(const uint64_t waitNs, const uint64_t nowNs) {
+        if (waitNs < mGrowNs || mIdleThreadCount.load(std::memory_order_relaxed) > 0U
+                || mThreadCount.load(std::memory_order_relaxed) >= mWorkers.size()) {
+            return;
+        }
+        uint64_t lastNs = mLastGrowNs.load(std::memory_order_relaxed);
+        if (nowNs < lastNs + mGrowNs
+                || !mLastGrowNs.compare_exchange_strong(lastNs, nowNs, std::memory_order_relaxed)) {
+            return;
+        }
+
+        // try only, the destructor joins workers under it
+        std::unique_lock<std::mutex> lock { mResizeLock, std::try_to_lock };
+        if (!lock.owns_lock() || !mIsRunning) {
+            return;
+        }
+        for (uint32_t i=0; i<mWorkers.size(); ++i) {
+            if (mWorkers[i]->active.load(std::memory_order_acquire)) {
+                continue;
+            }
+            // a retired thread, it has returned or is about to
+            if (mWorkers[i]->thread.joinable()) {
+                mWorkers[i]->thread.join();
+            }
+            ++mThreadCount;
+            ++mIdleThreadCount;
+            ++mAddedThreadCount;
+            startWorker(i);
+            return;
+        }
+    }
+
+    // a thread above the minimum leaves
+    bool tryRetire() {
+        uint32_t count = mThreadCount.load(std::memory_order_relaxed);
+        while (count > mMinThreadCount) {
+            if (mThreadCount.compare_exchange_weak(count, count - 1U,
+                    std::memory_order_relaxed)) {
+                ++mRetiredThreadCount;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void enqueue(Task *task, uint32_t node) {
+        enqueue(&task, 1U, node);
+    }
+
+    void enqueue(Task *task, const TaskOptions &options) {
+        if (options.deadline != std::chrono::steady_clock::time_point {}) {
+            task->lane = TaskLane::DEADLINE;
+            task->deadlineNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    options.deadline.time_since_epoch()).count();
+        } else if (options.priority == TaskPriority::HIGH) {
+            task->lane = TaskLane::HIGH;
+        } else if (options.priority == TaskPriority::LOW) {
+            task->lane = TaskLane::LOW;
+        }
+        enqueue(&task, 1U, options.node);
+    }
+
+    // all in the lane of the first one, under one lock per node, with one wake up for them all
+    void enqueue(Task* const *tasks, const std::size_t count, uint32_t node) {
+        if (0U == count) {
+            return;
+        }
+        uint64_t nowNs = 0U;
+        if (mStatsEnabled || mElastic) {
+            nowNs = getCurrentTimeNs();
+            for (std::size_t i=0; i<count; ++i) {
+                tasks[i]->submitNs = nowNs;
+            }
+        }
+        if (mStatsEnabled) {
+            countSubmit(tasks, count);
+        }
+        if (node >= mNodes.size()) {
+            node = ANY_NODE;
+        }
+        bool local = tPool == this && (node == ANY_NODE || node == mWorkers[tWorkerIndex]->node);
+        uint64_t oldestNs = UINT64_MAX;
+        if (local && tasks[0]->lane == TaskLane::NORMAL) {
+            for (std::size_t i=0; i<count; ++i) {
+                mWorkers[tWorkerIndex]->deque.push(tasks[i]);
+            }
+        } else if (local) {
+            // other lanes are visible to the whole node
+            oldestNs = pushToNode(*mNodes[mWorkers[tWorkerIndex]->node], tasks, count);
+        } else if (node != ANY_NODE || 1U == mNodes.size()) {
+            oldestNs = pushToNode(*mNodes[node == ANY_NODE ? 0U : node], tasks, count);
+        } else {
+            // spread over the nodes in turn
+            std::size_t nodeCount = mNodes.size();
+            std::size_t first = mNextNode.fetch_add(1U, std::memory_order_relaxed);
+            for (std::size_t i=0; i<nodeCount; ++i) {
+                std::size_t begin = count * i / nodeCount;
+                std::size_t end = count * (i + 1) / nodeCount;
+                oldestNs = std::min(oldestNs,
+                        pushToNode(*mNodes[(first + i) % nodeCount], tasks + begin, end - begin));
+            }
+        }
+
+        // pairs with the increase of mParkedCount in park
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mParkedCount.load(std::memory_order_relaxed) > 0U) {
+            std::lock_guard<std::mutex> lock { mLock };
+            if (count > 1U) {
+                mCv.notify_all();
+            } else {
+                mCv.notify_one();
+            }
+        }
+        if (mElastic && oldestNs < nowNs) {
+            growIfWaiting(nowNs - oldestNs, nowNs);
+        }
+    }
+
+    void countSubmit(Task* const *tasks, const std::size_t count) {
+        for (std::size_t i=0; i<count; ++i) {
+            tasks[i]->counted = true;
+        }
+        LaneCounters &counters = mLaneCounters[laneIndex(tasks[0]->lane)];
+        counters.submitCount.fetch_add(count, std::memory_order_relaxed);
+        int64_t depth = counters.depth.fetch_add(count, std::memory_order_relaxed) + count;
+        std::size_t maxDepth = counters.maxDepth.load(std::memory_order_relaxed);
+        while (depth > static_cast<int64_t>(maxDepth)
+                && !counters.maxDepth.compare_exchange_weak(maxDepth, depth,
+                        std::memory_order_relaxed)) {
+        }
+    }
+
+    // return submitNs of the oldest head of HIGH, NORMAL and LOW if elastic, else UINT64_MAX
+    uint64_t pushToNode(Node &node, Task* const *tasks, const std::size_t count) {
+        uint64_t oldestNs = UINT64_MAX;
+        if (0U == count) {
+            return oldestNs;
+        }
+        TaskLane lane = tasks[0]->lane;
+        std::lock_guard<std::mutex> lock { node.lock };
+        if (lane == TaskLane::DEADLINE) {
+            for (std::size_t i=0; i<count; ++i) {
+                node.deadlines.push_back({ tasks[i]->deadlineNs, node.sequence++, tasks[i] });
+                std::push_heap(node.deadlines.begin(), node.deadlines.end());
+            }
+        } else {
+            std::deque<Task*> &fifo = node.fifos[laneIndex(lane)];
+            fifo.insert(fifo.end(), tasks, tasks + count);
+        }
+        if (isUrgent(lane)) {
+            node.urgentSize.fetch_add(count, std::memory_order_relaxed);
+        }
+        updateAgedAtWithLock(node);
+        node.injectionSize.fetch_add(count, std::memory_order_relaxed);
+        if (mElastic) {
+            for (TaskLane head : { TaskLane::HIGH, TaskLane::NORMAL, TaskLane::LOW }) {
+                if (!node.fifos[laneIndex(head)].empty()) {
+                    oldestNs = std::min(oldestNs, node.fifos[laneIndex(head)].front()->submitNs);
+                }
+            }
+        }
+        return oldestNs;
+    }
+
+    /**
+     * a head of NORMAL or LOW is held back if a higher lane is not empty, the clock is read
+     * only when one starts to be, so there is no cost while all tasks are in one lane.
+     */
+    void updateAgedAtWithLock(Node &node) {
+        uint64_t agedAtNs = UINT64_MAX;
+        uint64_t nowNs = 0U;
+        bool higher = !node.fifos[laneIndex(TaskLane::HIGH)].empty() || !node.deadlines.empty();
+        for (TaskLane lane : { TaskLane::NORMAL, TaskLane::LOW }) {
+            const std::deque<Task*> &fifo = node.fifos[laneIndex(lane)];
+            if (fifo.empty()) {
+                continue;
+            }
+            if (higher) {
+                Task *head = fifo.front();
+                if (0U == head->blockedNs) {
+                    nowNs = nowNs > 0U ? nowNs : getCurrentTimeNs();
+                    head->blockedNs = nowNs;
+                }
+                agedAtNs = std::min(agedAtNs, head->blockedNs + mAgingNs);
+            }
+            higher = true;
+        }
+        node.agedAtNs.store(agedAtNs, std::memory_order_relaxed);
+    }
+
+    /**
+     * an aged head of NORMAL or LOW, the one held back longest, then HIGH, DEADLINE, NORMAL, LOW.
+     * urgentOnly stops before NORMAL.
+     */
+    Task* takeFromNode(Node &node, const bool urgentOnly) {
+        if (0U == node.injectionSize.load(std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        uint64_t agedAtNs = node.agedAtNs.load(std::memory_order_relaxed);
+        uint64_t nowNs = agedAtNs != UINT64_MAX ? getCurrentTimeNs() : 0U;
+        if (urgentOnly && 0U == node.urgentSize.load(std::memory_order_relaxed)
+                && nowNs < agedAtNs) {
+            return nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock { node.lock };
+        Task *task = nullptr;
+        std::deque<Task*> *aged = nullptr;
+        for (TaskLane lane : { TaskLane::NORMAL, TaskLane::LOW }) {
+            std::deque<Task*> &fifo = node.fifos[laneIndex(lane)];
+            if (!fifo.empty() && fifo.front()->blockedNs > 0U
+                    && fifo.front()->blockedNs + mAgingNs <= nowNs
+                    && (aged == nullptr || fifo.front()->blockedNs < aged->front()->blockedNs)) {
+                aged = &fifo;
+            }
+        }
+
+        if (aged != nullptr) {
+            task = aged->front();
+            aged->pop_front();
+            task->aged = true;
+        } else if (!node.fifos[laneIndex(TaskLane::HIGH)].empty()) {
+            task = node.fifos[laneIndex(TaskLane::HIGH)].front();
+            node.fifos[laneIndex(TaskLane::HIGH)].pop_front();
+        } else if (!node.deadlines.empty()) {
+            std::pop_heap(node.deadlines.begin(), node.deadlines.end());
+            task = node.deadlines.back().task;
+            node.deadlines.pop_back();
+        } else if (urgentOnly) {
+            return nullptr;
+        } else {
+            for (TaskLane lane : { TaskLane::NORMAL, TaskLane::LOW }) {
+                std::deque<Task*> &fifo = node.fifos[laneIndex(lane)];
+                if (!fifo.empty()) {
+                    task = fifo.front();
+                    fifo.pop_front();
+                    break;
+                }
+            }
+        }
+        if (task == nullptr) {
+            return nullptr;
+        }
+
+        if (isUrgent(task->lane)) {
+            node.urgentSize.fetch_sub(1U, std::memory_order_relaxed);
+        }
+        updateAgedAtWithLock(node);
+        node.injectionSize.fetch_sub(1U, std::memory_order_relaxed);
+        return task;
+    }
+
+    struct ForState {
+        std::atomic<std::size_t> next { 0U };
+        std::atomic<std::size_t> done { 0U };
+    };
+
+    std::size_t resolveGrain(const std::size_t total, const std::size_t grain) const {
+        if (grain > 0U) {
+            return grain;
+        }
+        return std::max<std::size_t>(1U, total / (mThreadCount * 4U));
+    }
+
+    static std::size_t chunkCount(const std::size_t total, const std::size_t grain) {
+        return (total + grain - 1U) / grain;
+    }
+
+    /**
+     * chunks are claimed one by one from a counter by the caller and up to one task per
+     * worker, so a slow chunk does not hold up the others.
+     * a task may start after the caller returns, it finds no chunk then and touches nothing
+     * but the state it owns.
+     */
+    template<class Index, class CHUNK>
+    void forEachChunk(const Index begin, const Index end, std::size_t grain, const CHUNK &chunk) {
+        static_assert(std::is_integral_v<Index>, "Index must be integral");
+        if (end <= begin) {
+            return;
+        }
+        const std::size_t total = end - begin;
+        grain = resolveGrain(total, grain);
+        const std::size_t count = chunkCount(total, grain);
+
+        auto state = std::make_shared<ForState>();
+        auto work = [state, &chunk, begin, end, grain, count]() {
+            std::size_t finished = 0U;
+            std::size_t index = 0U;
+            while ((index = state->next.fetch_add(1U, std::memory_order_relaxed)) < count) {
+                Index first = begin + static_cast<Index>(index * grain);
+                Index last = static_cast<std::size_t>(end - first) > grain
+                        ? first + static_cast<Index>(grain) : end;
+                chunk(index, first, last);
+                ++finished;
+            }
+            if (finished > 0U && state->done.fetch_add(finished, std::memory_order_acq_rel)
+                    + finished == count) {
+                state->done.notify_all();
+            }
+        };
+
+        std::size_t helpers = std::min<std::size_t>(count - 1U, mThreadCount);
+        std::vector<Task*> tasks;
+        tasks.reserve(helpers);
+        for (std::size_t i=0; i<helpers; ++i) {
+            tasks.push_back(newTask(work));
+        }
+        enqueue(tasks.data(), tasks.size(), ANY_NODE);
+
+        work();
+        std::size_t done = 0U;
+        while ((done = state->done.load(std::memory_order_acquire)) < count) {
+            state->done.wait(done, std::memory_order_acquire);
+        }
+    }
+
+    void run(const uint32_t index) {
+        tPool = this;
+        tWorkerIndex = index;
+        uint64_t seed = index + 1;
+        uint32_t spin = 0U;
+        while (true) {
+            if (Task *task = findTask(index, seed); task != nullptr) {
+                --mIdleThreadCount;
+                if (task->counted || mElastic) {
+                    uint64_t nowNs = getCurrentTimeNs();
+                    if (task->counted) {
+                        recordStart(*mWorkers[index], *task, nowNs);
                     }
-                    task();
-                    {
-                        std::unique_lock<std::mutex> lock { mLock };
-                        ++mIdleThreadCount;
+                    if (mElastic && nowNs > task->submitNs) {
+                        growIfWaiting(nowNs - task->submitNs, nowNs);
                     }
                 }
-            });
-            {
-                std::unique_lock<std::mutex> lock { mLock };
+                task->function();
+                deleteTask(task);
                 ++mIdleThreadCount;
+                spin = 0U;
+                continue;
+            }
+            if (!mIsRunning) {
+                return;
+            }
+            if (++spin < SPIN_COUNT) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (park()) {
+                --mIdleThreadCount;
+                mWorkers[index]->active.store(false, std::memory_order_release);
+                return;
+            }
+            spin = 0U;
+        }
+    }
+
+    void recordStart(Worker &worker, const Task &task, const uint64_t nowNs) {
+        mLaneCounters[laneIndex(task.lane)].depth.fetch_sub(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock { worker.statsLock };
+        WorkerLaneStats &stats = worker.stats[laneIndex(task.lane)];
+        stats.waitNs.record(nowNs - task.submitNs);
+        if (task.aged) {
+            ++stats.agedCount;
+        }
+        if (task.lane == TaskLane::DEADLINE && nowNs > task.deadlineNs) {
+            ++stats.lateCount;
+        }
+    }
+
+    /**
+     * urgent or aged tasks of own node unless the burst is used up, own deque,
+     * then own node, then the other nodes.
+     */
+    Task* findTask(const uint32_t index, uint64_t &seed) {
+        Worker &worker = *mWorkers[index];
+        Task *task = nullptr;
+        if (worker.urgentRun < mUrgentBurst) {
+            if (task = takeFromNode(*mNodes[worker.node], true); task != nullptr) {
+                worker.urgentRun = isUrgent(task->lane) ? worker.urgentRun + 1U : 0U;
+                return task;
+            }
+        }
+        worker.urgentRun = 0U;
+        if (worker.deque.pop(task)) {
+            return task;
+        }
+
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        for (std::size_t i=0; i<mNodes.size(); ++i) {
+            task = findTaskInNode(*mNodes[(worker.node + i) % mNodes.size()], index, seed);
+            if (task != nullptr) {
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    // the injection queues, then steal from a random victim
+    Task* findTaskInNode(Node &node, const uint32_t index, const uint64_t seed) {
+        Task *task = takeFromNode(node, false);
+        if (task != nullptr) {
+            return task;
+        }
+
+        std::size_t count = node.workers.size();
+        std::size_t start = count > 0U ? seed % count : 0U;
+        for (std::size_t i=0; i<count; ++i) {
+            uint32_t victim = node.workers[(start + i) % count];
+            if (victim != index && mWorkers[victim]->deque.steal(task)) {
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    bool hasTask() const {
+        for (auto &node : mNodes) {
+            if (node->injectionSize.load(std::memory_order_seq_cst) > 0U) {
+                return true;
+            }
+        }
+        for (auto &worker : mWorkers) {
+            if (!worker->deque.empty()) {
+                return true;
             }
         }
+        return false;
     }
+
+    /**
+     * true if the thread is to exit, after it parked for mIdleTimeout in an elastic pool.
+     * a task pushed meanwhile wakes another parked thread, the exiting one holds mLock.
+     */
+    bool park() {
+        std::unique_lock<std::mutex> lock { mLock };
+        // a task pushed before this is seen by the check below, one after it sees the count
+        mParkedCount.fetch_add(1U, std::memory_order_seq_cst);
+        bool retire = false;
+        if (mIsRunning && !hasTask()) {
+            if (!mElastic) {
+                mCv.wait(lock);
+            } else if (std::cv_status::timeout == mCv.wait_for(lock, mIdleTimeout)) {
+                retire = mIsRunning && !hasTask() && tryRetire();
+            }
+        }
+        mParkedCount.fetch_sub(1U, std::memory_order_relaxed);
+        return retire;
+    }
+
  private:
-    using Task = std::function<void()>;
-    std::vector<std::thread> mThreadPool;
-    std::queue<Task> mTaskPool;
-    std::mutex mLock;
+    inline static thread_local ThreadPool *tPool = nullptr;
+    inline static thread_local uint32_t tWorkerIndex = 0U;
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+    std::vector<std::unique_ptr<Node>> mNodes;
+    std::atomic<uint32_t> mNextNode { 0U };  // for commits from outside of the pool
+    std::atomic<uint32_t> mParkedCount { 0U };
+    std::mutex mLock;  // for parking
     std::condition_variable mCv;
     std::atomic<bool> mIsRunning { true };
-    std::atomic<uint8_t> mIdleThreadCount { 0 };
+    std::atomic<uint32_t> mIdleThreadCount { 0U };
+    std::atomic<uint32_t> mThreadCount { 0U };
+    uint32_t mMinThreadCount = 0U;
+    bool mElastic = false;
+    std::mutex mResizeLock;  // for starting and joining threads
+    std::atomic<uint64_t> mLastGrowNs { 0U };
+    std::atomic<uint64_t> mAddedThreadCount { 0U };
+    std::atomic<uint64_t> mRetiredThreadCount { 0U };
+    const uint64_t mAgingNs;
+    const uint32_t mUrgentBurst;
+    const uint64_t mGrowNs;
+    const std::chrono::nanoseconds mIdleTimeout;
+    std::atomic_bool mStatsEnabled { false };
+    std::array<LaneCounters, TASK_LANE_COUNT> mLaneCounters;
 };
 
 }  // namespace cpfw
 
 #endif  // CPFW_BASE_INCLUDE_THREADPOOL_HPP_
-
@@ -0,0 +1,153 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPFW_BASE_INCLUDE_WORKSTEALINGDEQUE_HPP_
+#define CPFW_BASE_INCLUDE_WORKSTEALINGDEQUE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace cpfw {
+
+/**
+ * @brief Chase-Lev work-stealing deque, no lock in.
+ * the owner thread pushes and pops at the bottom, any thread steals from the top.
+ * T is kept in atomics, so it should be a pointer or a small trivially copyable type.
+ * the array grows when full, old arrays are kept until destruction since a thief
+ * may still read them.
+ */
+template<typename T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+ public:
+    explicit WorkStealingDeque(std::size_t capacity = 256U) {
+        std::size_t size = 1U;
+        while (size < capacity) {
+            size <<= 1U;
+        }
+        mArrays.push_back(std::make_unique<Array>(size));
+        mArray.store(mArrays.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // owner only
+    void push(T value) {
+        int64_t bottom = mBottom.load(std::memory_order_relaxed);
+        int64_t top = mTop.load(std::memory_order_acquire);
+        Array *array = mArray.load(std::memory_order_relaxed);
+        if (bottom - top > static_cast<int64_t>(array->size) - 1) {
+            array = grow(array, bottom, top);
+        }
+        array->put(bottom, value);
+        mBottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    // owner only, the newest one
+    bool pop(T &value) {
+        int64_t bottom = mBottom.load(std::memory_order_relaxed) - 1;
+        Array *array = mArray.load(std::memory_order_relaxed);
+        mBottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = mTop.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            mBottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+        value = array->get(bottom);
+        if (top == bottom) {
+            // the last one, race with thieves for it
+            bool won = mTop.compare_exchange_strong(top, top + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed);
+            mBottom.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // any thread, the oldest one. false if empty or lost the race to another thread
+    bool steal(T &value) {
+        int64_t top = mTop.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = mBottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return false;
+        }
+
+        Array *array = mArray.load(std::memory_order_acquire);
+        value = array->get(top);
+        return mTop.compare_exchange_strong(top, top + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // a hint only when other threads are working on it
+    bool empty() const {
+        return mBottom.load(std::memory_order_acquire) <= mTop.load(std::memory_order_acquire);
+    }
+
+    // a hint as empty
+    std::size_t size() const {
+        int64_t size = mBottom.load(std::memory_order_acquire)
+                - mTop.load(std::memory_order_acquire);
+        return size > 0 ? size : 0U;
+    }
+
+ private:
+    struct Array {
+        explicit Array(std::size_t capacity)
+                : size(capacity), mask(capacity - 1U), slots(new std::atomic<T>[capacity]) {
+        }
+
+        T get(int64_t index) const {
+            return slots[index & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t index, T value) {
+            slots[index & mask].store(value, std::memory_order_relaxed);
+        }
+
+        const std::size_t size;
+        const std::size_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+    };
+
+    Array* grow(Array *array, int64_t bottom, int64_t top) {
+        auto bigger = std::make_unique<Array>(array->size * 2U);
+        for (int64_t i=top; i<bottom; ++i) {
+            bigger->put(i, array->get(i));
+        }
+        mArrays.push_back(std::move(bigger));
+        mArray.store(mArrays.back().get(), std::memory_order_release);
+        return mArrays.back().get();
+    }
+
+ private:
+    alignas(64) std::atomic<int64_t> mTop { 0 };
+    alignas(64) std::atomic<int64_t> mBottom { 0 };
+    std::atomic<Array*> mArray;
+    std::vector<std::unique_ptr<Array>> mArrays;  // touched by the owner only
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_WORKSTEALINGDEQUE_HPP_
@@ -0,0 +1,235 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPFW_BASE_INCLUDE_UTILITIES_ASYNC_LOG_H_
+#define CPFW_BASE_INCLUDE_UTILITIES_ASYNC_LOG_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace cpfw {
+
+/**
+ * @brief log backend which formats on a background thread, like NanoLog.
+ * the caller only copies the format pointer and the arguments into a ring of its
+ * own thread, no lock and no formatting. strings are copied, others must be
+ * trivially copyable, which is all printf takes.
+ * records are dropped and counted if the ring is full.
+ * used by Log.hpp when CPFW_LOG_ASYNC is defined.
+ */
+class AsyncLog {
+ public:
+    // never destroyed, so logs from static destructors are still safe
+    static AsyncLog& getInstance();
+
+    /**
+     * @param format must outlive the process, e.g. a literal.
+     */
+    template<typename... Args>
+    void write(const char *format, const Args&... args) {
+        std::size_t size = sizeof(RecordHeader);
+        ((size += Codec<Decay<Args>>::size(args)), ...);
+        size = (size + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+
+        LogRing &ring = getThreadRing();
+        uint8_t *record = ring.reserve(size);
+        if (nullptr == record) {
+            mDropCount.fetch_add(1U, std::memory_order_relaxed);
+            return;
+        }
+        RecordHeader header { static_cast<uint32_t>(size), &formatRecord<Decay<Args>...>, format };
+        std::memcpy(record, &header, sizeof(header));
+        uint8_t *data = record + sizeof(header);
+        ((data = Codec<Decay<Args>>::encode(data, args)), ...);
+        ring.commit();
+
+        // stopped at exit, nobody else prints it
+        if (!mRunning.load(std::memory_order_acquire)) {
+            flush();
+        }
+    }
+
+    // print all records written so far, on the calling thread
+    void flush();
+
+    uint64_t getDropCount() const;
+
+ private:
+    using FormatFunction = void (*)(const char *format, const uint8_t *data, std::string &out);
+
+    struct RecordHeader {
+        uint32_t size;  // the whole record
+        FormatFunction formatter;  // nullptr for padding up to the end of the ring
+        const char *format;
+    };
+
+    static constexpr std::size_t RECORD_ALIGN = alignof(RecordHeader);
+    static constexpr std::size_t LINE_SIZE = 256U;
+
+    /**
+     * single-producer single-consumer byte ring, the producer is the owner thread,
+     * the consumer is whoever holds mConsumerMutex.
+     * records never wrap, the space left at the end is skipped.
+     */
+    class LogRing {
+     public:
+        static constexpr std::size_t CAPACITY = 1U << 20U;
+
+        uint8_t* reserve(std::size_t size) {
+            uint64_t head = mHead.load(std::memory_order_relaxed);
+            std::size_t offset = head & (CAPACITY - 1U);
+            std::size_t left = CAPACITY - offset;
+            std::size_t skip = left < size ? left : 0U;
+            // read the tail of the consumer only when it looks full, it is on another core
+            if (head + skip + size - mCachedTail > CAPACITY) {
+                mCachedTail = mTail.load(std::memory_order_acquire);
+                if (head + skip + size - mCachedTail > CAPACITY) {
+                    return nullptr;
+                }
+            }
+            if (skip >= sizeof(RecordHeader)) {
+                RecordHeader padding { static_cast<uint32_t>(skip), nullptr, nullptr };
+                std::memcpy(&mBuffer[offset], &padding, sizeof(padding));
+            }
+            mPending = head + skip + size;
+            return &mBuffer[(head + skip) & (CAPACITY - 1U)];
+        }
+
+        void commit() {
+            mHead.store(mPending, std::memory_order_release);
+        }
+
+        // format all committed records into out
+        void drain(std::string &out);
+
+        bool empty() const {
+            return mHead.load(std::memory_order_acquire) == mTail.load(std::memory_order_relaxed);
+        }
+
+     private:
+        alignas(64) std::atomic<uint64_t> mHead { 0U };
+        uint64_t mPending = 0U;
+        uint64_t mCachedTail = 0U;
+        alignas(64) std::atomic<uint64_t> mTail { 0U };
+        std::unique_ptr<RecordHeader[]> mStorage {
+                new RecordHeader[CAPACITY / sizeof(RecordHeader)] };
+        uint8_t *mBuffer = reinterpret_cast<uint8_t*>(mStorage.get());
+    };
+
+    // char arrays and pointers are all taken as strings
+    template<typename T>
+    using Decay = std::conditional_t<std::is_same_v<std::decay_t<T>, char*>,
+            const char*, std::decay_t<T>>;
+
+    template<typename T>
+    struct Codec {
+        static_assert(std::is_trivially_copyable_v<T>, "log argument must be trivially copyable");
+
+        static std::size_t size(const T &) {
+            return sizeof(T);
+        }
+        static uint8_t* encode(uint8_t *data, const T &value) {
+            std::memcpy(data, &value, sizeof(T));
+            return data + sizeof(T);
+        }
+        static T decode(const uint8_t *&data) {
+            T value;
+            std::memcpy(&value, data, sizeof(T));
+            data += sizeof(T);
+            return value;
+        }
+    };
+
+    template<typename... Args>
+    static void formatRecord(const char *format, const uint8_t *data, std::string &out) {
+        // braced init is evaluated in order
+        std::tuple<Args...> values { Codec<Args>::decode(data)... };
+        std::apply([format, &out](const auto&... value) {
+            // most lines fit, format again only for a longer one
+            char line[LINE_SIZE];
+            int length = std::snprintf(line, sizeof(line), format, value...);
+            if (length < 0) {
+                return;
+            }
+            if (static_cast<std::size_t>(length) < sizeof(line)) {
+                out.append(line, length);
+                return;
+            }
+            std::size_t begin = out.size();
+            out.resize(begin + length + 1);
+            std::snprintf(&out[begin], length + 1, format, value...);
+            out.resize(begin + length);
+        }, values);
+    }
+
+    AsyncLog();
+
+    LogRing& getThreadRing();
+
+    void run();
+
+    // stop the background thread and print the rest, at exit
+    void stop();
+
+    // with mConsumerMutex held
+    void drainWithLock();
+
+ private:
+    std::atomic_bool mRunning { true };
+    std::atomic<uint64_t> mDropCount { 0U };
+    uint64_t mReportedDropCount = 0U;
+    std::mutex mRingsMutex;
+    std::vector<std::shared_ptr<LogRing>> mRings;
+    std::mutex mConsumerMutex;
+    std::string mOut;
+    std::mutex mWakeMutex;
+    std::condition_variable mWakeCv;
+    std::thread mThread;
+};
+
+template<>
+struct AsyncLog::Codec<const char*> {
+    static std::size_t size(const char *value) {
+        return std::strlen(value != nullptr ? value : NULL_STRING) + 1U;
+    }
+    static uint8_t* encode(uint8_t *data, const char *value) {
+        std::size_t length = size(value);
+        std::memcpy(data, value != nullptr ? value : NULL_STRING, length);
+        return data + length;
+    }
+    static const char* decode(const uint8_t *&data) {
+        const char *value = reinterpret_cast<const char*>(data);
+        data += std::strlen(value) + 1U;
+        return value;
+    }
+
+    static constexpr const char *NULL_STRING = "(null)";
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_UTILITIES_ASYNC_LOG_H_
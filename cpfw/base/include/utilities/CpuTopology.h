@@ -0,0 +1,46 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPFW_BASE_INCLUDE_UTILITIES_CPU_TOPOLOGY_H_
+#define CPFW_BASE_INCLUDE_UTILITIES_CPU_TOPOLOGY_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cpfw {
+
+struct NumaNode {
+    uint32_t id;
+    std::vector<uint32_t> cpus;  // ascending, only the ones this process may run on
+};
+
+/**
+ * @brief NUMA nodes read from /sys/devices/system/node.
+ * one node with all allowed cpus if there is no such info, never empty.
+ */
+std::vector<NumaNode> getNumaNodes();
+
+// e.g. "0-3,8,10-11" of sysfs cpulist
+std::vector<uint32_t> parseCpuList(const std::string &list);
+
+// 0 or -errno, -ENOTSUP if not linux
+int32_t pinCurrentThread(const uint32_t cpu);
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_UTILITIES_CPU_TOPOLOGY_H_
@@ -0,0 +1,75 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPFW_BASE_INCLUDE_UTILITIES_HISTOGRAM_H_
+#define CPFW_BASE_INCLUDE_UTILITIES_HISTOGRAM_H_
+
+#include <array>
+#include <cstdint>
+
+namespace cpfw {
+
+/**
+ * @brief log-linear histogram like HdrHistogram, e.g. for latencies in ns.
+ * values are grouped by their highest bit, and each group is split into
+ * SUB_BUCKET_COUNT linear buckets, so the error is below 1/SUB_BUCKET_COUNT
+ * at any magnitude. fixed size, so record never allocates.
+ */
+class Histogram {
+ public:
+    static constexpr uint32_t SUB_BUCKET_BITS = 3U;
+    static constexpr uint32_t SUB_BUCKET_COUNT = 1U << SUB_BUCKET_BITS;
+    static constexpr uint32_t BUCKET_COUNT = (64U - SUB_BUCKET_BITS + 1U) * SUB_BUCKET_COUNT;
+
+    void record(const uint64_t value);
+
+    void merge(const Histogram &other);
+
+    void reset();
+
+    uint64_t getCount() const;
+
+    uint64_t getMin() const;
+
+    uint64_t getMax() const;
+
+    double getMean() const;
+
+    /**
+     * @brief value which percentile% of records are not above.
+     *
+     * @param percentile in [0, 100].
+     * @return uint64_t upper bound of the bucket it falls in, 0 if empty.
+     */
+    uint64_t getPercentile(const double percentile) const;
+
+ private:
+    static uint32_t indexOf(const uint64_t value);
+
+    static uint64_t upperOf(const uint32_t index);
+
+ private:
+    std::array<uint64_t, BUCKET_COUNT> mCounts {};
+    uint64_t mCount = 0U;
+    uint64_t mMin = UINT64_MAX;
+    uint64_t mMax = 0U;
+    uint64_t mSum = 0U;
+};
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_UTILITIES_HISTOGRAM_H_
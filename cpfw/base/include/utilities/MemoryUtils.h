@@ -0,0 +1,57 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CPFW_BASE_INCLUDE_UTILITIES_MEMORY_UTILS_H_
+#define CPFW_BASE_INCLUDE_UTILITIES_MEMORY_UTILS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cpfw {
+
+std::size_t getPageSize();
+
+/**
+ * @brief map size bytes twice back to back, so [*data, *data + 2 * size) shows the same bytes
+ * twice and any size bytes from an offset below size are contiguous.
+ * linux only, by memfd_create and two mmaps over one reserved range.
+ *
+ * @param size a multiple of getPageSize().
+ * @return 0 or -errno, -ENOTSUP if not linux.
+ */
+int32_t mapMirrored(std::size_t size, void **data);
+
+// size as given to mapMirrored
+void unmapMirrored(void *data, std::size_t size);
+
+// the default huge page size on x86-64 and arm64
+constexpr std::size_t HUGE_PAGE_SIZE = 2U << 20U;
+
+/**
+ * @brief anonymous memory from reserved huge pages, or if there are none, normal pages
+ * with transparent huge pages asked for by madvise.
+ *
+ * @param size a multiple of HUGE_PAGE_SIZE.
+ * @return 0 or -errno, -ENOTSUP if not linux.
+ */
+int32_t mapHugePages(std::size_t size, void **data);
+
+void unmapHugePages(void *data, std::size_t size);
+
+}  // namespace cpfw
+
+#endif  // CPFW_BASE_INCLUDE_UTILITIES_MEMORY_UTILS_H_
@@ -21,8 +21,11 @@
 
 namespace cpfw {
 
+// both on the steady clock, so they can be mixed with std::chrono::steady_clock
 uint64_t getCurrentTimeMs();
 
+uint64_t getCurrentTimeNs();
+
 }  // namespace cpfw
 
 #endif  // CPFW_BASE_INCLUDE_UTILITIES_TIME_UTILS_H_
@@ -17,7 +17,10 @@
 
 #include "Handler.h"
 
+#include <algorithm>
+#include <bit>
 #include <chrono>
+#include <string>
 
 #include "Log.hpp"
 #include "MapUtils.hpp"
@@ -25,92 +28,364 @@
 
 namespace cpfw {
 
-Handler::Handler() {
-    mMsgPool = std::make_unique<MessagePool>();
+Handler::Handler(MessageQueueType type) : Handler(nullptr, type) {
+}
+
+Handler::Handler(std::shared_ptr<Looper> looper, MessageQueueType type)
+        : mLooper(std::move(looper)) {
+    mMsgPool = std::make_unique<MessagePool>(type);
     mRunning.store(true);
-    mWorkingThread = std::thread(&Handler::handleMessage, this);
+    if (mLooper) {
+        mLooper->attach(this);
+    } else {
+        mWorkingThread = std::thread(&Handler::handleMessage, this);
+    }
 }
 
 Handler::~Handler() {
     mRunning.store(false);
-    Message msg;
-    post(msg);
+    if (mLooper) {
+        mLooper->detach(this);
+        return;
+    }
+    post(Message());
     mWorkingThread.join();
 }
 
+void Handler::setBatchMode(bool enable, uint32_t maxBatchSize) {
+    mMaxBatchSize.store(std::max(maxBatchSize, 1U));
+    mBatchMode.store(enable);
+}
+
+BatchStats Handler::getBatchStats() {
+    std::lock_guard<std::mutex> lck(mStatsMutex);
+    return mBatchStats;
+}
+
+void Handler::setRecycleCapacity(std::size_t capacity) {
+    mRecycler.setCapacity(capacity);
+    mRecycling.store(capacity > 0U);
+}
+
+Message Handler::obtain() {
+    return mRecycler.obtain();
+}
+
+void Handler::recycle(Message &&msg) {
+    mRecycler.recycle(std::move(msg));
+}
+
+RecyclerStats Handler::getRecyclerStats() {
+    return mRecycler.getStats();
+}
+
 int32_t Handler::post(const Message &msg) {
     return postDelay(msg, 0);
 }
 
+int32_t Handler::post(Message &&msg) {
+    return postDelay(std::move(msg), 0);
+}
+
 int32_t Handler::postDelay(const Message &msg, uint64_t delayMs) {
-    LOGI("postDelay flag:%d", msg.mFlag);
+    return postDelay(msg, std::chrono::milliseconds(delayMs));
+}
 
+int32_t Handler::postDelay(Message &&msg, uint64_t delayMs) {
+    return postDelay(std::move(msg), std::chrono::milliseconds(delayMs));
+}
+
+int32_t Handler::postDelay(const Message &msg, std::chrono::nanoseconds delay) {
     if (0 != (msg.mFlag & PostFlag::SYNC)) {
         return onInvoke(msg);
     }
 
-    uint64_t whenMs = getCurrentTimeMs() + delayMs;
+    return postDelay(Message(msg), delay);
+}
+
+int32_t Handler::postDelay(Message &&msg, std::chrono::nanoseconds delay) {
+    LOGV("postDelay flag:%d", msg.mFlag);
+
+    if (0 != (msg.mFlag & PostFlag::SYNC)) {
+        return onInvoke(msg);
+    }
+
+    uint64_t currentTimeNs = getCurrentTimeNs();
+    uint64_t whenNs = currentTimeNs + std::max<int64_t>(delay.count(), 0);
+    return postAt(std::move(msg), whenNs, currentTimeNs);
+}
+
+int32_t Handler::postWhen(const Message &msg, uint64_t whenMs) {
+    return postWhen(Message(msg), whenMs);
+}
+
+int32_t Handler::postWhen(Message &&msg, uint64_t whenMs) {
+    uint64_t currentTimeMs = getCurrentTimeMs();
+    if (currentTimeMs > whenMs) {
+        return 0;  // The task is planned to do at a past time. Ignore it.
+    }
+
+    return postDelay(std::move(msg),
+            std::chrono::milliseconds(whenMs) - std::chrono::milliseconds(currentTimeMs));
+}
+
+int32_t Handler::postWhen(const Message &msg, std::chrono::steady_clock::time_point when) {
+    return postWhen(Message(msg), when);
+}
+
+int32_t Handler::postWhen(Message &&msg, std::chrono::steady_clock::time_point when) {
+    uint64_t whenNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            when.time_since_epoch()).count();
+    uint64_t currentTimeNs = getCurrentTimeNs();
+    if (currentTimeNs > whenNs) {
+        return 0;  // The task is planned to do at a past time. Ignore it.
+    }
+
+    if (0 != (msg.mFlag & PostFlag::SYNC)) {
+        return onInvoke(msg);
+    }
+    return postAt(std::move(msg), whenNs, currentTimeNs);
+}
+
+HandlerAwaiter Handler::schedule() {
+    return HandlerAwaiter(*this, std::chrono::nanoseconds(0));
+}
+
+HandlerAwaiter sleepFor(Handler &handler, std::chrono::nanoseconds delay) {
+    return HandlerAwaiter(handler, delay);
+}
+
+bool HandlerAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    Message msg;
+    msg.mWhat = WHAT_RUNNABLE;
+    msg.mRunnable = [handle] {
+        handle.resume();
+    };
+    // the handler may resume it before postDelay returns, then this is gone
+    int32_t status = mHandler.postDelay(std::move(msg), mDelay);
+    if (0 != status) {
+        mStatus = status;
+        return false;
+    }
+    return true;
+}
+
+void Handler::removeMessages(uint64_t what) {
+    mMsgPool->erase(what);
+}
+
+bool Handler::hasMessages(uint64_t what) {
+    return mMsgPool->contains(what);
+}
+
+int32_t Handler::postAt(Message &&msg, uint64_t whenNs, uint64_t postNs) {
+    msg.mWhenNs = whenNs;
+    msg.mPostNs = postNs;
+    uint64_t what = msg.mWhat;
     int32_t ret = 0;
     if (0 != (msg.mFlag & PostFlag::DELETE_FORMER)) {
-        mMsgPool->postAndDeleteFormers(whenMs, msg, msg.mWhat);
+        mMsgPool->postAndDeleteFormers(whenNs, std::move(msg), what);
     } else if (0 != (msg.mFlag & PostFlag::OMIT_IF_EXIST)) {
-        mMsgPool->postButOmitIfExist(whenMs, msg, msg.mWhat);
+        mMsgPool->postButOmitIfExist(whenNs, std::move(msg), what);
+    } else if (whenNs <= postNs && PostFlag::NONE == msg.mFlag) {
+        mMsgPool->postImmediate(whenNs, std::move(msg));
     } else {
-        mMsgPool->post(whenMs, msg, msg.mWhat);
+        mMsgPool->post(whenNs, std::move(msg));
+    }
+    if (mLooper) {
+        mLooper->schedule(this, whenNs);
     }
     return ret;
 }
 
-int32_t Handler::postWhen(const Message &msg, uint64_t whenMs) {
-    uint64_t currentTimeMs = getCurrentTimeMs();
-    if (currentTimeMs > whenMs) {
-        return 0;  // The task is planned to do at a past time. Ignore it.
+void Handler::postNextLoop(Message &&msg) {
+    uint64_t intervalNs = 0U;
+    uint64_t delayMs = 0U;
+    bool hasInterval = msg.mSmallBundle.getSafe(KEY_ID_INTERVAL_NS, intervalNs);
+    if (!hasInterval && (msg.mSmallBundle.getSafe(KEY_ID_DELAY_TIME_MS, delayMs)
+            || msg.mBundle.getSafe(KEY_DELAY_TIME_MS, delayMs))) {
+        intervalNs = std::chrono::nanoseconds(std::chrono::milliseconds(delayMs)).count();
+        hasInterval = true;
+    }
+    if (!hasInterval) {
+        mMsgPool->dropLoop(msg.mWhat);
+        return;
     }
 
-    return postDelay(msg, whenMs - currentTimeMs);
+    uint64_t currentTimeNs = getCurrentTimeNs();
+    uint64_t whenNs = msg.mWhenNs + intervalNs;
+    if (0U == intervalNs) {
+        whenNs = currentTimeNs;
+    } else if (whenNs <= currentTimeNs) {
+        // overrun, keep the phase and skip the periods missed instead of bursting
+        whenNs += ((currentTimeNs - whenNs) / intervalNs + 1) * intervalNs;
+    }
+    msg.mWhenNs = whenNs;
+    msg.mPostNs = currentTimeNs;
+    // dropped if removeMessages came during the invoke
+    if (mMsgPool->repostLoop(whenNs, std::move(msg)) && mLooper) {
+        mLooper->schedule(this, whenNs);
+    }
 }
 
 void Handler::handleMessage() {
     LOGI("handleMessage");
+    std::vector<Message> msgs;
     while (mRunning.load()) {
-        auto itor = mMsgPool->front();
-        uint64_t currentTimeMs = getCurrentTimeMs();
-        if (itor->first > currentTimeMs) {
-            if (std::cv_status::no_timeout
-                    == mMsgPool->waitFor(itor->first-currentTimeMs)) {
-                continue;
-            }
+        bool batchMode = mBatchMode.load();
+        msgs.clear();
+        if (!mMsgPool->pollDue(msgs, batchMode ? mMaxBatchSize.load() : 1U)) {
+            continue;
         }
 
         if (!mRunning.load()) {
             break;
         }
 
-        const Message &msg = itor->second;
+        dispatch(msgs, batchMode);
+    }
+}
+
+uint64_t Handler::dispatchOnce() {
+    if (!mRunning.load()) {
+        return MessagePool::NO_DEADLINE;
+    }
+
+    bool batchMode = mBatchMode.load();
+    mDueMsgs.clear();
+    uint64_t nextWhenNs = mMsgPool->takeDue(mDueMsgs, batchMode ? mMaxBatchSize.load() : 1U);
+    if (!mDueMsgs.empty()) {
+        dispatch(mDueMsgs, batchMode);
+    }
+    return nextWhenNs;
+}
 
+void Handler::dispatch(std::vector<Message> &msgs, bool batchMode) {
+    bool statsEnabled = mStatsEnabled.load();
+    uint64_t startNs = statsEnabled ? getCurrentTimeNs() : 0U;
+    if (batchMode) {
+        invokeBatch(msgs);
+        recordBatch(msgs.size());
+    } else if (const Message &msg = msgs.front(); nullptr != msg.mRunnable) {
+        msg.mRunnable();
+    } else {
         int32_t status = onInvoke(msg);
-        LOGI("handleMessage invoke over status:%d", status);
+        LOGV("handleMessage invoke over status:%d", status);
         reply(msg, status);
+    }
+    if (statsEnabled) {
+        recordStats(msgs, startNs, getCurrentTimeNs());
+    }
 
+    for (Message &msg : msgs) {
         if (0 != (msg.mFlag & PostFlag::LOOP)) {
-            uint64_t delayMs = 0;
-            Bundle &bundle = const_cast<Message&>(msg).mBundle;
-            if (bundle.getSafe(KEY_DELAY_TIME_MS, delayMs)) {
-                postDelay(msg, delayMs);
-            }
+            postNextLoop(std::move(msg));
         }
+    }
 
-        // why del here? msg is a reference, if del before LOOP check, msg would be null
-        mMsgPool->popFront();
+    if (mRecycling.load()) {
+        std::erase_if(msgs, [](const Message &msg) {
+            return 0 != (msg.mFlag & PostFlag::LOOP);
+        });
+        mRecycler.recycle(msgs);
     }
 }
 
+void Handler::invokeBatch(std::span<const Message> msgs) {
+    std::size_t first = 0U;
+    for (std::size_t i=0; i<msgs.size(); ++i) {
+        if (nullptr == msgs[i].mRunnable) {
+            continue;
+        }
+        if (i > first) {
+            onInvokeBatch(msgs.subspan(first, i - first));
+        }
+        msgs[i].mRunnable();
+        first = i + 1;
+    }
+    if (msgs.size() > first) {
+        onInvokeBatch(msgs.subspan(first));
+    }
+}
+
+void Handler::onInvokeBatch(std::span<const Message> msgs) {
+    for (const Message &msg : msgs) {
+        int32_t status = onInvoke(msg);
+        reply(msg, status);
+    }
+}
+
+void Handler::setStatsEnabled(bool enable) {
+    mStatsEnabled.store(enable);
+}
+
+HandlerStats Handler::getStats() {
+    std::size_t queueDepth = mMsgPool->size();
+    std::size_t maxQueueDepth = mMsgPool->getMaxSize();
+    std::lock_guard<std::mutex> lck(mStatsMutex);
+    HandlerStats stats = mStats;
+    stats.queueDepth = queueDepth;
+    stats.maxQueueDepth = maxQueueDepth;
+    stats.batch = mBatchStats;
+    return stats;
+}
+
+void Handler::resetStats() {
+    std::lock_guard<std::mutex> lck(mStatsMutex);
+    mStats = HandlerStats();
+    mBatchStats = BatchStats();
+}
+
+void Handler::dumpStats(const char *header) {
+    HandlerStats stats = getStats();
+    LOGI("<%s> dispatch:%lu depth:%zu maxDepth:%zu batches:%lu",
+            header, stats.dispatchCount, stats.queueDepth, stats.maxQueueDepth,
+            stats.batch.batchCount);
+
+    auto dumpHistogram = [header](const char *name, const Histogram &histogram) {
+        LOGI("<%s> %-16s count:%lu mean:%.0f p50:%lu p99:%lu p999:%lu max:%lu (ns)",
+                header, name, histogram.getCount(), histogram.getMean(),
+                histogram.getPercentile(50.0), histogram.getPercentile(99.0),
+                histogram.getPercentile(99.9), histogram.getMax());
+    };
+    dumpHistogram("latency", stats.latencyNs);
+    dumpHistogram("late", stats.lateNs);
+    for (const auto &[what, histogram] : stats.invokeNsByWhat) {
+        std::string name = "invoke what:" + std::to_string(what);
+        dumpHistogram(name.c_str(), histogram);
+    }
+}
+
+void Handler::recordStats(std::span<const Message> msgs, uint64_t startNs, uint64_t endNs) {
+    uint64_t invokeNs = (endNs - startNs) / msgs.size();
+    std::lock_guard<std::mutex> lck(mStatsMutex);
+    mStats.dispatchCount += msgs.size();
+    for (const Message &msg : msgs) {
+        // the posting thread may read the clock after this one
+        mStats.latencyNs.record(startNs > msg.mPostNs ? startNs - msg.mPostNs : 0U);
+        if (msg.mWhenNs > msg.mPostNs) {
+            mStats.lateNs.record(startNs > msg.mWhenNs ? startNs - msg.mWhenNs : 0U);
+        }
+        mStats.invokeNsByWhat[msg.mWhat].record(invokeNs);
+    }
+}
+
+void Handler::recordBatch(std::size_t batchSize) {
+    std::lock_guard<std::mutex> lck(mStatsMutex);
+    ++mBatchStats.batchCount;
+    mBatchStats.messageCount += batchSize;
+    mBatchStats.lastBatchSize = batchSize;
+    mBatchStats.maxBatchSize = std::max<uint32_t>(mBatchStats.maxBatchSize, batchSize);
+    std::size_t bucket = std::bit_width(batchSize) - 1;
+    ++mBatchStats.sizeBuckets[std::min(bucket, BatchStats::BUCKET_COUNT - 1)];
+}
+
 void Handler::reply(const Message &msg, int32_t status) {
     if (nullptr != msg.mCallback) {
-        LOGI("reply to widget");
+        LOGV("reply to widget");
         msg.mCallback(status);
     } else {
-        LOGI("reply to Handler status:%d", status);
+        LOGV("reply to Handler status:%d", status);
         onReply(msg, status);
     }
 }
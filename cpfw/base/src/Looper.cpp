@@ -0,0 +1,176 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "Looper"
+
+#include "Looper.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "Handler.h"
+#include "Log.hpp"
+#include "MessagePool.h"
+#include "TimeUtils.h"
+
+namespace cpfw {
+
+Looper::Looper(uint32_t threadCount) {
+    threadCount = std::max(threadCount, 1U);
+    LOGD("Looper ctor threadCount:%u", threadCount);
+    for (uint32_t i=0; i<threadCount; ++i) {
+        mThreads.emplace_back(&Looper::loop, this);
+    }
+}
+
+Looper::~Looper() {
+    {
+        std::lock_guard<std::mutex> lck(mMutex);
+        mRunning = false;
+    }
+    mCv.notify_all();
+    for (std::thread &thrd : mThreads) {
+        thrd.join();
+    }
+}
+
+std::size_t Looper::getThreadCount() const {
+    return mThreads.size();
+}
+
+std::size_t Looper::getHandlerCount() {
+    std::lock_guard<std::mutex> lck(mMutex);
+    return mEntries.size();
+}
+
+void Looper::attach(Handler *handler) {
+    std::lock_guard<std::mutex> lck(mMutex);
+    mEntries.emplace(handler, Entry { .timerNs = MessagePool::NO_DEADLINE });
+}
+
+void Looper::detach(Handler *handler) {
+    std::unique_lock<std::mutex> lck(mMutex);
+    auto itor = mEntries.find(handler);
+    if (itor == mEntries.end()) {
+        return;
+    }
+
+    Entry &entry = itor->second;
+    mIdleCv.wait(lck, [&entry]() {
+        return !entry.running;
+    });
+    if (entry.ready) {
+        std::erase(mReady, handler);
+    }
+    if (entry.timerNs != MessagePool::NO_DEADLINE) {
+        mTimers.erase({ entry.timerNs, handler });
+    }
+    mEntries.erase(itor);
+}
+
+void Looper::schedule(Handler *handler, uint64_t whenNs) {
+    std::lock_guard<std::mutex> lck(mMutex);
+    auto itor = mEntries.find(handler);
+    if (itor == mEntries.end()) {
+        return;
+    }
+
+    Entry &entry = itor->second;
+    if (entry.running) {
+        // the worker running it reads its queue again when done
+        entry.dirty = true;
+    } else if (whenNs <= getCurrentTimeNs()) {
+        readyWithLock(handler, entry);
+    } else {
+        armTimerWithLock(handler, entry, whenNs);
+    }
+}
+
+void Looper::loop() {
+    std::unique_lock<std::mutex> lck(mMutex);
+    while (mRunning) {
+        uint64_t currentTimeNs = getCurrentTimeNs();
+        while (!mTimers.empty() && mTimers.begin()->first <= currentTimeNs) {
+            Handler *handler = mTimers.begin()->second;
+            Entry &entry = mEntries.at(handler);
+            mTimers.erase(mTimers.begin());
+            entry.timerNs = MessagePool::NO_DEADLINE;
+            readyWithLock(handler, entry);
+        }
+
+        if (mReady.empty()) {
+            if (mTimers.empty()) {
+                mCv.wait(lck);
+            } else {
+                mCv.wait_until(lck, std::chrono::steady_clock::time_point(
+                        std::chrono::nanoseconds(mTimers.begin()->first)));
+            }
+            continue;
+        }
+
+        Handler *handler = mReady.front();
+        mReady.pop_front();
+        // entries are only erased by detach, which waits while it is running
+        Entry &entry = mEntries.at(handler);
+        entry.ready = false;
+        entry.running = true;
+        entry.dirty = false;
+        lck.unlock();
+
+        uint64_t nextWhenNs = handler->dispatchOnce();
+
+        lck.lock();
+        entry.running = false;
+        // to the back of mReady if still due, so other handlers get their turn
+        if (entry.dirty || nextWhenNs <= getCurrentTimeNs()) {
+            readyWithLock(handler, entry);
+        } else if (nextWhenNs != MessagePool::NO_DEADLINE) {
+            armTimerWithLock(handler, entry, nextWhenNs);
+        }
+        mIdleCv.notify_all();
+    }
+}
+
+void Looper::readyWithLock(Handler *handler, Entry &entry) {
+    if (entry.ready) {
+        return;
+    }
+    if (entry.timerNs != MessagePool::NO_DEADLINE) {
+        mTimers.erase({ entry.timerNs, handler });
+        entry.timerNs = MessagePool::NO_DEADLINE;
+    }
+    entry.ready = true;
+    mReady.push_back(handler);
+    mCv.notify_one();
+}
+
+void Looper::armTimerWithLock(Handler *handler, Entry &entry, uint64_t whenNs) {
+    if (entry.ready || whenNs >= entry.timerNs) {
+        return;
+    }
+    if (entry.timerNs != MessagePool::NO_DEADLINE) {
+        mTimers.erase({ entry.timerNs, handler });
+    }
+    entry.timerNs = whenNs;
+    mTimers.emplace(whenNs, handler);
+    // a worker may be waiting for a later timer
+    if (mTimers.begin()->second == handler) {
+        mCv.notify_one();
+    }
+}
+
+}  // namespace cpfw
@@ -18,98 +18,198 @@
 
 #include "MessagePool.h"
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 #include "Log.hpp"
+#include "TimeUtils.h"
 
 namespace cpfw {
 
-MessagePool::MessagePool() {
-    LOGD("MessagePool ctor");
+MessagePool::MessagePool(MessageQueueType type) : mQueue(MessageQueue::create(type)) {
+    LOGD("MessagePool ctor type:%d", static_cast<int32_t>(type));
 }
 
 MessagePool::~MessagePool() {
 }
 
-void MessagePool::post(const uint64_t whenMs, const Message &message, const uint64_t what) {
+void MessagePool::post(const uint64_t whenNs, Message &&message) {
     std::unique_lock<std::shared_mutex> lck(mMutex);
-    postWithLock(whenMs, message, what);
+    postWithLock(whenNs, std::move(message));
     notify();
 }
 
+void MessagePool::postImmediate(const uint64_t whenNs, Message &&message) {
+    mInbox.push({ whenNs, std::move(message) });
+    // pairs with waitWithLock: either the consumer sees the entry or we see it waiting
+    if (mWaiting.load()) {
+        std::unique_lock<std::shared_mutex> lck(mMutex);
+        notify();
+    }
+}
+
 void MessagePool::postAndDeleteFormers(
-        const uint64_t whenMs, const Message &message, const uint64_t what) {
+        const uint64_t whenNs, Message &&message, const uint64_t what) {
     std::unique_lock<std::shared_mutex> lck(mMutex);
-    deleteMessage(what);
-    postWithLock(whenMs, message, what);
+    drainInboxWithLock();
+    mQueue->erase(what);
+    postWithLock(whenNs, std::move(message));
     notify();
 }
 
 void MessagePool::postButOmitIfExist(
-        const uint64_t whenMs, const Message &message, const uint64_t what) {
+        const uint64_t whenNs, Message &&message, const uint64_t what) {
     std::unique_lock<std::shared_mutex> lck(mMutex);
-    if (findEntry(what)) {
+    drainInboxWithLock();
+    if (mQueue->contains(what)) {
         return;
     }
-    postWithLock(whenMs, message, what);
+    postWithLock(whenNs, std::move(message));
     notify();
 }
 
-std::multimap<const uint64_t, const Message>::iterator MessagePool::front() {
-    wait();
-    return mQueue.begin();
+bool MessagePool::pollDue(std::vector<Message> &messages, const std::size_t maxCount) {
+    std::unique_lock<std::shared_mutex> lck(mMutex);
+    drainInboxWithLock();
+    if (mQueue->empty()) {
+        waitWithLock([this, &lck]() {
+            mCv.wait(lck);
+        });
+        return false;
+    }
+
+    uint64_t whenNs = mQueue->frontWhenNs();
+    uint64_t currentTimeNs = getCurrentTimeNs();
+    if (whenNs > currentTimeNs) {
+        // absolute deadline, so the time spent to get here is not waited again
+        waitWithLock([this, &lck, &whenNs]() {
+            mCv.wait_until(lck, std::chrono::steady_clock::time_point(
+                    std::chrono::nanoseconds(whenNs)));
+        });
+        return false;
+    }
+
+    takeDueWithLock(messages, maxCount, currentTimeNs);
+    return true;
+}
+
+uint64_t MessagePool::takeDue(std::vector<Message> &messages, const std::size_t maxCount) {
+    std::unique_lock<std::shared_mutex> lck(mMutex);
+    drainInboxWithLock();
+    takeDueWithLock(messages, maxCount, getCurrentTimeNs());
+    return mQueue->empty() ? NO_DEADLINE : mQueue->frontWhenNs();
 }
 
-void MessagePool::popFront() {
-    std::shared_lock<std::shared_mutex> lck(mMutex);
-    if (!mQueue.empty()) {
-        auto itorToDel = mQueue.begin();
-        // mQueue must keep path with mFlagTable, so no need to check nullptr
-        auto range = mFlagTable.equal_range(itorToDel->second.mWhat);
-        if (range.first != range.second) {
-            mFlagTable.erase(range.first);
+void MessagePool::erase(const uint64_t what) {
+    std::unique_lock<std::shared_mutex> lck(mMutex);
+    drainInboxWithLock();
+    mQueue->erase(what);
+    for (TakenLoop &loop : mTakenLoops) {
+        if (loop.what == what) {
+            loop.cancelled = true;
         }
-        mQueue.erase(itorToDel);
     }
 }
 
+bool MessagePool::repostLoop(const uint64_t whenNs, Message &&message) {
+    std::unique_lock<std::shared_mutex> lck(mMutex);
+    // checked and posted under one lock, so an erase is either seen here or finds it queued
+    if (releaseLoopWithLock(message.mWhat)) {
+        return false;
+    }
+    postWithLock(whenNs, std::move(message));
+    notify();
+    return true;
+}
+
+void MessagePool::dropLoop(const uint64_t what) {
+    std::unique_lock<std::shared_mutex> lck(mMutex);
+    releaseLoopWithLock(what);
+}
+
+bool MessagePool::contains(const uint64_t what) {
+    std::unique_lock<std::shared_mutex> lck(mMutex);
+    drainInboxWithLock();
+    return mQueue->contains(what);
+}
+
 void MessagePool::clear() {
     std::unique_lock<std::shared_mutex> lck(mMutex);
-    mQueue.clear();
-    mFlagTable.clear();
+    drainInboxWithLock();
+    mQueue->clear();
+    for (TakenLoop &loop : mTakenLoops) {
+        loop.cancelled = true;
+    }
 }
 
 void MessagePool::notify() {
     mCv.notify_one();
 }
 
-void MessagePool::wait() {
+std::size_t MessagePool::size() {
     std::unique_lock<std::shared_mutex> lck(mMutex);
-    if (mQueue.empty()) {
-        mCv.wait(lck);
-    }
+    drainInboxWithLock();
+    return mQueue->size();
 }
 
-std::cv_status MessagePool::waitFor(uint64_t waitTimeMs) {
+std::size_t MessagePool::getMaxSize() {
     std::unique_lock<std::shared_mutex> lck(mMutex);
-    return mCv.wait_for(lck, std::chrono::milliseconds(waitTimeMs));
+    drainInboxWithLock();
+    return mMaxSize;
 }
 
-void MessagePool::postWithLock(
-        const uint64_t whenMs, const Message &message, const uint64_t what) {
-    mQueue.emplace(whenMs, message);
-    mFlagTable.emplace(what, whenMs);
+void MessagePool::postWithLock(const uint64_t whenNs, Message &&message) {
+    // keep the order with immediate messages posted before
+    drainInboxWithLock();
+    mQueue->push(whenNs, std::move(message), whenNs <= getCurrentTimeNs());
+    mMaxSize = std::max(mMaxSize, mQueue->size());
 }
 
-void MessagePool::deleteMessage(const uint64_t what) {
-    std::erase_if(mQueue, [&what](const auto& item) {
-        auto const& [whenMs, message] = item;
-        return message.mWhat == what;
-    });
+void MessagePool::takeDueWithLock(std::vector<Message> &messages,
+        const std::size_t maxCount, const uint64_t currentTimeNs) {
+    // moved out under lock, so posts during invoke can not touch them
+    while (messages.size() < maxCount && !mQueue->empty()
+            && mQueue->frontWhenNs() <= currentTimeNs) {
+        Message &message = messages.emplace_back();
+        mQueue->popFront(message);
+        if (0 != (message.mFlag & PostFlag::LOOP)) {
+            mTakenLoops.push_back({ message.mWhat, false });
+        }
+    }
+}
+
+void MessagePool::drainInboxWithLock() {
+    InboxEntry entry;
+    while (!mInbox.empty()) {
+        if (!mInbox.pop(entry)) {
+            // a producer is linking its entry, it is done in a few instructions
+            std::this_thread::yield();
+            continue;
+        }
+        mQueue->push(entry.whenNs, std::move(entry.message), true);
+    }
+    mMaxSize = std::max(mMaxSize, mQueue->size());
+}
 
-    mFlagTable.erase(what);
+bool MessagePool::releaseLoopWithLock(const uint64_t what) {
+    auto itor = std::find_if(mTakenLoops.begin(), mTakenLoops.end(),
+            [what](const TakenLoop &loop) { return loop.what == what; });
+    if (itor == mTakenLoops.end()) {
+        return false;
+    }
+    bool cancelled = itor->cancelled;
+    mTakenLoops.erase(itor);
+    return cancelled;
 }
 
-bool MessagePool::findEntry(const uint64_t what) {
-    return mFlagTable.find(what) != mFlagTable.end();
+template<typename TWait>
+void MessagePool::waitWithLock(TWait wait) {
+    mWaiting.store(true);
+    if (mInbox.empty()) {
+        wait();
+    }
+    mWaiting.store(false);
 }
 
 }  // namespace cpfw
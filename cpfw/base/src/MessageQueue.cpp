@@ -0,0 +1,299 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MessageQueue"
+
+#include "MessageQueue.h"
+
+#include "Log.hpp"
+
+namespace cpfw {
+
+std::unique_ptr<MessageQueue> MessageQueue::create(MessageQueueType type) {
+    switch (type) {
+    case MessageQueueType::MULTIMAP:
+        return std::make_unique<MultimapMessageQueue>();
+    case MessageQueueType::HEAP:
+        return std::make_unique<HeapMessageQueue>();
+    default:
+        LOGE("unknown queue type:%d", static_cast<int32_t>(type));
+        return std::make_unique<HeapMessageQueue>();
+    }
+}
+
+void MultimapMessageQueue::push(const uint64_t whenNs, Message &&message, const bool due) {
+    uint64_t what = message.mWhat;
+    // a due message mostly goes to the back, the hint makes that O(1)
+    auto itor = due ? mQueue.emplace_hint(mQueue.end(), whenNs, std::move(message))
+            : mQueue.emplace(whenNs, std::move(message));
+    mFlagTable[what].insert(itor);
+}
+
+uint64_t MultimapMessageQueue::frontWhenNs() const {
+    return mQueue.begin()->first;
+}
+
+void MultimapMessageQueue::popFront(Message &message) {
+    auto itorToDel = mQueue.begin();
+    // mQueue must keep path with mFlagTable, so no need to check nullptr
+    mFlagTable[itorToDel->second.mWhat].erase(itorToDel);
+    message = std::move(itorToDel->second);
+    mQueue.erase(itorToDel);
+}
+
+void MultimapMessageQueue::erase(const uint64_t what) {
+    auto flagItor = mFlagTable.find(what);
+    if (flagItor == mFlagTable.end()) {
+        return;
+    }
+    for (auto itor : flagItor->second) {
+        mQueue.erase(itor);
+    }
+    flagItor->second.clear();
+}
+
+bool MultimapMessageQueue::contains(const uint64_t what) const {
+    auto itor = mFlagTable.find(what);
+    return itor != mFlagTable.end() && !itor->second.empty();
+}
+
+void MultimapMessageQueue::clear() {
+    mQueue.clear();
+    mFlagTable.clear();
+}
+
+bool MultimapMessageQueue::empty() const {
+    return mQueue.empty();
+}
+
+std::size_t MultimapMessageQueue::size() const {
+    return mQueue.size();
+}
+
+void HeapMessageQueue::push(const uint64_t whenNs, Message &&message, const bool due) {
+    uint32_t slot = allocateSlot(std::move(message));
+    Key key { whenNs, mSequence++, slot };
+    mNodes[slot].key = key;
+
+    // producers may read the clock in a different order than they get the lock
+    if (due && (mFifoTail == NIL || mNodes[mFifoTail].key.whenNs <= whenNs)) {
+        fifoPushBack(slot);
+        return;
+    }
+    heapPush(key);
+}
+
+uint64_t HeapMessageQueue::frontWhenNs() const {
+    return isFrontInFifo() ? mNodes[mFifoHead].key.whenNs : mHeap.front().whenNs;
+}
+
+void HeapMessageQueue::popFront(Message &message) {
+    uint32_t slot = isFrontInFifo() ? mFifoHead : mHeap.front().slot;
+    message = std::move(mSlots[slot]);
+    removeSlot(slot);
+}
+
+void HeapMessageQueue::erase(const uint64_t what) {
+    auto itor = mWhatTable.find(what);
+    if (itor == mWhatTable.end()) {
+        return;
+    }
+    // removeSlot moves the head to the next one
+    while (itor->second.head != NIL) {
+        removeSlot(itor->second.head);
+    }
+}
+
+bool HeapMessageQueue::contains(const uint64_t what) const {
+    auto itor = mWhatTable.find(what);
+    return itor != mWhatTable.end() && itor->second.count > 0U;
+}
+
+void HeapMessageQueue::clear() {
+    mSlots.clear();
+    mNodes.clear();
+    mFreeSlots.clear();
+    mHeap.clear();
+    mFifoHead = NIL;
+    mFifoTail = NIL;
+    mFifoSize = 0U;
+    mWhatTable.clear();
+}
+
+bool HeapMessageQueue::empty() const {
+    return mHeap.empty() && 0U == mFifoSize;
+}
+
+std::size_t HeapMessageQueue::size() const {
+    return mHeap.size() + mFifoSize;
+}
+
+uint32_t HeapMessageQueue::allocateSlot(Message &&message) {
+    uint32_t slot = 0U;
+    uint64_t what = message.mWhat;
+    if (mFreeSlots.empty()) {
+        slot = mSlots.size();
+        mSlots.push_back(std::move(message));
+        mNodes.emplace_back();
+    } else {
+        slot = mFreeSlots.back();
+        mFreeSlots.pop_back();
+        mSlots[slot] = std::move(message);
+    }
+
+    // push front of the what list
+    Node &node = mNodes[slot];
+    WhatList &list = mWhatTable[what];
+    node.what = what;
+    node.heapIndex = NIL;
+    node.whatPrev = NIL;
+    node.whatNext = list.head;
+    if (list.head != NIL) {
+        mNodes[list.head].whatPrev = slot;
+    }
+    list.head = slot;
+    ++list.count;
+    return slot;
+}
+
+void HeapMessageQueue::releaseSlot(const uint32_t slot) {
+    Message &message = mSlots[slot];
+    Node &node = mNodes[slot];
+    // keep the entry when it drops to 0, whats are reused and it saves a node per post
+    WhatList &list = mWhatTable[node.what];
+    if (node.whatPrev != NIL) {
+        mNodes[node.whatPrev].whatNext = node.whatNext;
+    } else {
+        list.head = node.whatNext;
+    }
+    if (node.whatNext != NIL) {
+        mNodes[node.whatNext].whatPrev = node.whatPrev;
+    }
+    --list.count;
+
+    // drop the bundle and callback now instead of when the slot is reused
+    message = Message();
+    mFreeSlots.push_back(slot);
+}
+
+void HeapMessageQueue::removeSlot(const uint32_t slot) {
+    if (mNodes[slot].heapIndex != NIL) {
+        heapRemove(mNodes[slot].heapIndex);
+    } else {
+        fifoUnlink(slot);
+    }
+    releaseSlot(slot);
+}
+
+void HeapMessageQueue::heapPush(const Key &key) {
+    mHeap.push_back(key);
+    mNodes[key.slot].heapIndex = mHeap.size() - 1;
+    siftUp(mHeap.size() - 1);
+}
+
+void HeapMessageQueue::heapRemove(const uint32_t index) {
+    mNodes[mHeap[index].slot].heapIndex = NIL;
+    Key last = mHeap.back();
+    mHeap.pop_back();
+    if (index == mHeap.size()) {
+        return;
+    }
+
+    heapPlace(index, last);
+    if (index > 0U && earlier(last, mHeap[(index - 1) / 2])) {
+        siftUp(index);
+    } else {
+        siftDown(index);
+    }
+}
+
+void HeapMessageQueue::heapPlace(const uint32_t index, const Key &key) {
+    mHeap[index] = key;
+    mNodes[key.slot].heapIndex = index;
+}
+
+void HeapMessageQueue::siftUp(uint32_t index) {
+    Key key = mHeap[index];
+    while (index > 0U) {
+        uint32_t parent = (index - 1) / 2;
+        if (!earlier(key, mHeap[parent])) {
+            break;
+        }
+        heapPlace(index, mHeap[parent]);
+        index = parent;
+    }
+    heapPlace(index, key);
+}
+
+void HeapMessageQueue::siftDown(uint32_t index) {
+    Key key = mHeap[index];
+    uint32_t size = mHeap.size();
+    while (true) {
+        uint32_t child = 2 * index + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && earlier(mHeap[child + 1], mHeap[child])) {
+            ++child;
+        }
+        if (!earlier(mHeap[child], key)) {
+            break;
+        }
+        heapPlace(index, mHeap[child]);
+        index = child;
+    }
+    heapPlace(index, key);
+}
+
+void HeapMessageQueue::fifoPushBack(const uint32_t slot) {
+    Node &node = mNodes[slot];
+    node.prev = mFifoTail;
+    node.next = NIL;
+    if (mFifoTail != NIL) {
+        mNodes[mFifoTail].next = slot;
+    } else {
+        mFifoHead = slot;
+    }
+    mFifoTail = slot;
+    ++mFifoSize;
+}
+
+void HeapMessageQueue::fifoUnlink(const uint32_t slot) {
+    Node &node = mNodes[slot];
+    if (node.prev != NIL) {
+        mNodes[node.prev].next = node.next;
+    } else {
+        mFifoHead = node.next;
+    }
+    if (node.next != NIL) {
+        mNodes[node.next].prev = node.prev;
+    } else {
+        mFifoTail = node.prev;
+    }
+    --mFifoSize;
+}
+
+bool HeapMessageQueue::isFrontInFifo() const {
+    if (mFifoHead == NIL) {
+        return false;
+    }
+    if (mHeap.empty()) {
+        return true;
+    }
+    return earlier(mNodes[mFifoHead].key, mHeap.front());
+}
+
+}  // namespace cpfw
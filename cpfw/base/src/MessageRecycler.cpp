@@ -0,0 +1,98 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MessageRecycler"
+
+#include "MessageRecycler.h"
+
+#include "Log.hpp"
+
+namespace cpfw {
+
+MessageRecycler::MessageRecycler(std::size_t capacity) : mCapacity(capacity) {
+}
+
+void MessageRecycler::setCapacity(std::size_t capacity) {
+    std::lock_guard<std::mutex> lck(mMutex);
+    mCapacity = capacity;
+    if (mFreeList.size() > mCapacity) {
+        mFreeList.resize(mCapacity);
+    }
+    mFreeList.reserve(mCapacity);
+}
+
+std::size_t MessageRecycler::getCapacity() {
+    std::lock_guard<std::mutex> lck(mMutex);
+    return mCapacity;
+}
+
+Message MessageRecycler::obtain() {
+    std::lock_guard<std::mutex> lck(mMutex);
+    ++mStats.obtainCount;
+    if (mFreeList.empty()) {
+        return Message();
+    }
+
+    ++mStats.hitCount;
+    Message message = std::move(mFreeList.back());
+    mFreeList.pop_back();
+    return message;
+}
+
+void MessageRecycler::recycle(Message &&message) {
+    reset(message);
+    std::lock_guard<std::mutex> lck(mMutex);
+    recycleWithLock(std::move(message));
+}
+
+void MessageRecycler::recycle(std::span<Message> messages) {
+    for (Message &message : messages) {
+        reset(message);
+    }
+    std::lock_guard<std::mutex> lck(mMutex);
+    for (Message &message : messages) {
+        recycleWithLock(std::move(message));
+    }
+}
+
+RecyclerStats MessageRecycler::getStats() {
+    std::lock_guard<std::mutex> lck(mMutex);
+    return mStats;
+}
+
+void MessageRecycler::reset(Message &message) {
+    message.mWhat = 0U;
+    message.mArg1 = 0;
+    message.mArg2 = 0;
+    message.mCallback = nullptr;
+    message.mBundle.clear();
+    message.mSmallBundle.clearValues();
+    message.mFlag = PostFlag::NONE;
+    message.mWhenNs = 0U;
+    message.mPostNs = 0U;
+    message.mRunnable = nullptr;
+}
+
+void MessageRecycler::recycleWithLock(Message &&message) {
+    ++mStats.recycleCount;
+    if (mFreeList.size() >= mCapacity) {
+        ++mStats.dropCount;
+        return;
+    }
+    mFreeList.push_back(std::move(message));
+}
+
+}  // namespace cpfw
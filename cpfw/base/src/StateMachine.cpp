@@ -23,8 +23,9 @@ namespace cpfw {
 StateMachine::StateMachine() : StateMachine("") {
 }
 
-StateMachine::StateMachine(const std::string &name) : mName(name) {
-    mHandler = std::make_unique<StateMachineHandler>(this);
+StateMachine::StateMachine(const std::string &name, std::shared_ptr<Looper> looper)
+        : mName(name) {
+    mHandler = std::make_unique<StateMachineHandler>(this, looper);
 }
 
 StateMachine::~StateMachine() {
@@ -64,15 +65,16 @@ void StateMachine::transitStateTo(uint32_t stateId) {
 }
 
 void StateMachine::sendMessage(Message message) {
-    mHandler->post(message);
+    mHandler->post(std::move(message));
 }
 
 std::shared_ptr<State> StateMachine::getCurrentState() {
     return mCurrentState;
 }
 
-StateMachine::StateMachineHandler::StateMachineHandler(StateMachine *stateMachine)
-    : mStateMachine(stateMachine) {
+StateMachine::StateMachineHandler::StateMachineHandler(StateMachine *stateMachine,
+        std::shared_ptr<Looper> looper)
+    : Handler(looper), mStateMachine(stateMachine) {
     LOGI("StateMachineHandler ctor");
 }
 
@@ -0,0 +1,131 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "AsyncLog.h"
+
+#include <chrono>
+#include <cstdlib>
+
+namespace cpfw {
+
+namespace {
+    constexpr std::chrono::milliseconds POLL_INTERVAL(1);
+}
+
+AsyncLog& AsyncLog::getInstance() {
+    static AsyncLog *instance = []() {
+        AsyncLog *log = new AsyncLog();
+        std::atexit([]() {
+            getInstance().stop();
+        });
+        return log;
+    }();
+    return *instance;
+}
+
+AsyncLog::AsyncLog() {
+    mThread = std::thread(&AsyncLog::run, this);
+}
+
+void AsyncLog::flush() {
+    std::lock_guard<std::mutex> lck(mConsumerMutex);
+    drainWithLock();
+}
+
+uint64_t AsyncLog::getDropCount() const {
+    return mDropCount.load(std::memory_order_relaxed);
+}
+
+AsyncLog::LogRing& AsyncLog::getThreadRing() {
+    thread_local std::shared_ptr<LogRing> ring = [this]() {
+        auto newRing = std::make_shared<LogRing>();
+        std::lock_guard<std::mutex> lck(mRingsMutex);
+        mRings.push_back(newRing);
+        return newRing;
+    }();
+    return *ring;
+}
+
+void AsyncLog::run() {
+    while (mRunning.load(std::memory_order_acquire)) {
+        flush();
+        std::unique_lock<std::mutex> lck(mWakeMutex);
+        mWakeCv.wait_for(lck, POLL_INTERVAL);
+    }
+}
+
+void AsyncLog::stop() {
+    {
+        std::lock_guard<std::mutex> lck(mWakeMutex);
+        mRunning.store(false, std::memory_order_release);
+    }
+    mWakeCv.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+    flush();
+}
+
+void AsyncLog::drainWithLock() {
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+        std::lock_guard<std::mutex> lck(mRingsMutex);
+        // the ring of an exited thread is only held here, drop it once printed
+        std::erase_if(mRings, [](const std::shared_ptr<LogRing> &ring) {
+            return ring.use_count() == 1 && ring->empty();
+        });
+        rings = mRings;
+    }
+
+    for (auto &ring : rings) {
+        ring->drain(mOut);
+    }
+
+    uint64_t dropCount = mDropCount.load(std::memory_order_relaxed);
+    if (dropCount != mReportedDropCount) {
+        mOut += "[AsyncLog    ] [W] dropped " + std::to_string(dropCount - mReportedDropCount)
+                + " records, ring full\n";
+        mReportedDropCount = dropCount;
+    }
+
+    if (!mOut.empty()) {
+        std::fwrite(mOut.data(), 1U, mOut.size(), stdout);
+        std::fflush(stdout);
+        mOut.clear();
+    }
+}
+
+void AsyncLog::LogRing::drain(std::string &out) {
+    uint64_t tail = mTail.load(std::memory_order_relaxed);
+    uint64_t head = mHead.load(std::memory_order_acquire);
+    while (tail != head) {
+        std::size_t offset = tail & (CAPACITY - 1U);
+        std::size_t left = CAPACITY - offset;
+        if (left < sizeof(RecordHeader)) {
+            tail += left;
+            continue;
+        }
+
+        RecordHeader header;
+        std::memcpy(&header, &mBuffer[offset], sizeof(header));
+        if (nullptr != header.formatter) {
+            header.formatter(header.format, &mBuffer[offset + sizeof(header)], out);
+        }
+        tail += header.size;
+    }
+    mTail.store(tail, std::memory_order_release);
+}
+
+}  // namespace cpfw
@@ -0,0 +1,150 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "CpuTopology"
+
+#include "CpuTopology.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "Log.hpp"
+
+namespace cpfw {
+
+namespace {
+    [[maybe_unused]] const char *NODE_DIR = "/sys/devices/system/node";
+
+    std::vector<uint32_t> getAllowedCpus() {
+        std::vector<uint32_t> cpus;
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (0 == sched_getaffinity(0, sizeof(set), &set)) {
+            for (uint32_t cpu=0; cpu<CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+#endif
+        if (cpus.empty()) {
+            uint32_t count = std::max(1U, std::thread::hardware_concurrency());
+            for (uint32_t cpu=0; cpu<count; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+}
+
+std::vector<uint32_t> parseCpuList(const std::string &list) {
+    std::vector<uint32_t> cpus;
+    std::size_t pos = 0U;
+    while (pos < list.size()) {
+        std::size_t end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        std::string range = list.substr(pos, end - pos);
+        pos = end + 1;
+
+        char *next = nullptr;
+        unsigned long first = std::strtoul(range.c_str(), &next, 10);
+        if (next == range.c_str()) {
+            continue;  // blank, e.g. the newline at the end
+        }
+        unsigned long last = first;
+        if (*next == '-') {
+            last = std::strtoul(next + 1, nullptr, 10);
+        }
+        for (unsigned long cpu=first; cpu<=last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::vector<NumaNode> getNumaNodes() {
+    std::vector<uint32_t> allowed = getAllowedCpus();
+    std::vector<NumaNode> nodes;
+
+#if defined(__linux__)
+    if (DIR *dir = opendir(NODE_DIR); dir != nullptr) {
+        while (dirent *entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4
+                    || name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue;
+            }
+            std::ifstream file(std::string(NODE_DIR) + "/" + name + "/cpulist");
+            std::string list;
+            std::getline(file, list);
+
+            NumaNode node { static_cast<uint32_t>(std::stoul(name.substr(4))), {} };
+            for (uint32_t cpu : parseCpuList(list)) {
+                if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+                    node.cpus.push_back(cpu);
+                }
+            }
+            // memory only nodes, or none of its cpus allowed
+            if (!node.cpus.empty()) {
+                nodes.push_back(std::move(node));
+            }
+        }
+        closedir(dir);
+    }
+#endif
+
+    if (nodes.empty()) {
+        nodes.push_back({ 0U, std::move(allowed) });
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const NumaNode &left, const NumaNode &right) {
+        return left.id < right.id;
+    });
+    return nodes;
+}
+
+int32_t pinCurrentThread(const uint32_t cpu) {
+#if defined(__linux__)
+    if (cpu >= CPU_SETSIZE) {
+        return -EINVAL;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int32_t ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (ret != 0) {
+        LOGW("pin to cpu %u failed, %d", cpu, ret);
+        return -ret;
+    }
+    return 0;
+#else
+    return -ENOTSUP;
+#endif
+}
+
+}  // namespace cpfw
@@ -0,0 +1,100 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "Histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace cpfw {
+
+void Histogram::record(const uint64_t value) {
+    ++mCounts[indexOf(value)];
+    ++mCount;
+    mMin = std::min(mMin, value);
+    mMax = std::max(mMax, value);
+    mSum += value;
+}
+
+void Histogram::merge(const Histogram &other) {
+    for (uint32_t i=0; i<BUCKET_COUNT; ++i) {
+        mCounts[i] += other.mCounts[i];
+    }
+    mCount += other.mCount;
+    mMin = std::min(mMin, other.mMin);
+    mMax = std::max(mMax, other.mMax);
+    mSum += other.mSum;
+}
+
+void Histogram::reset() {
+    *this = Histogram();
+}
+
+uint64_t Histogram::getCount() const {
+    return mCount;
+}
+
+uint64_t Histogram::getMin() const {
+    return mCount == 0U ? 0U : mMin;
+}
+
+uint64_t Histogram::getMax() const {
+    return mMax;
+}
+
+double Histogram::getMean() const {
+    return mCount == 0U ? 0.0 : static_cast<double>(mSum) / mCount;
+}
+
+uint64_t Histogram::getPercentile(const double percentile) const {
+    if (mCount == 0U) {
+        return 0U;
+    }
+
+    double clamped = std::clamp(percentile, 0.0, 100.0);
+    uint64_t target = std::max<uint64_t>(std::ceil(mCount * clamped / 100.0), 1U);
+    uint64_t accumulated = 0U;
+    for (uint32_t i=0; i<BUCKET_COUNT; ++i) {
+        accumulated += mCounts[i];
+        if (accumulated >= target) {
+            return std::min(upperOf(i), mMax);
+        }
+    }
+    return mMax;
+}
+
+uint32_t Histogram::indexOf(const uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return value;
+    }
+    // the highest bit picks the group, the next SUB_BUCKET_BITS bits the bucket in it
+    uint32_t highestBit = std::bit_width(value) - 1U;
+    uint32_t shift = highestBit - SUB_BUCKET_BITS;
+    uint32_t subBucket = (value >> shift) & (SUB_BUCKET_COUNT - 1U);
+    return (shift + 1U) * SUB_BUCKET_COUNT + subBucket;
+}
+
+uint64_t Histogram::upperOf(const uint32_t index) {
+    uint32_t group = index / SUB_BUCKET_COUNT;
+    if (group == 0U) {
+        return index;
+    }
+    uint32_t shift = group - 1U;
+    uint64_t lower = static_cast<uint64_t>(SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT) << shift;
+    return lower + ((1ULL << shift) - 1U);
+}
+
+}  // namespace cpfw
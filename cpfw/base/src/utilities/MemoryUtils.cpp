@@ -0,0 +1,132 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "MemoryUtils"
+
+#include "MemoryUtils.h"
+
+#include <cerrno>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "Log.hpp"
+
+namespace cpfw {
+
+std::size_t getPageSize() {
+#if defined(__linux__)
+    static const std::size_t pageSize = sysconf(_SC_PAGESIZE);
+    return pageSize;
+#else
+    return 4096U;
+#endif
+}
+
+int32_t mapMirrored(std::size_t size, void **data) {
+#if defined(__linux__)
+    if (0U == size || 0U != size % getPageSize() || nullptr == data) {
+        return -EINVAL;
+    }
+
+    int32_t fd = memfd_create("cpfw-mirrored", MFD_CLOEXEC);
+    if (fd < 0) {
+        int32_t err = errno;
+        LOGE("memfd_create failed errno:%d", err);
+        return -err;
+    }
+    if (0 != ftruncate(fd, size)) {
+        int32_t err = errno;
+        LOGE("ftruncate %zu failed errno:%d", size, err);
+        close(fd);
+        return -err;
+    }
+
+    // reserve both halves at once so nothing else is mapped between them
+    char *base = static_cast<char*>(mmap(nullptr, 2U * size, PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (MAP_FAILED == base) {
+        int32_t err = errno;
+        LOGE("reserve %zu failed errno:%d", 2U * size, err);
+        close(fd);
+        return -err;
+    }
+    for (char *half : { base, base + size }) {
+        if (MAP_FAILED == mmap(half, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                fd, 0)) {
+            int32_t err = errno;
+            LOGE("map %zu failed errno:%d", size, err);
+            munmap(base, 2U * size);
+            close(fd);
+            return -err;
+        }
+    }
+    // the mappings keep the memory
+    close(fd);
+    *data = base;
+    return 0;
+#else
+    return -ENOTSUP;
+#endif
+}
+
+void unmapMirrored(void *data, std::size_t size) {
+#if defined(__linux__)
+    if (nullptr != data) {
+        munmap(data, 2U * size);
+    }
+#endif
+}
+
+int32_t mapHugePages(std::size_t size, void **data) {
+#if defined(__linux__)
+    if (0U == size || 0U != size % HUGE_PAGE_SIZE || nullptr == data) {
+        return -EINVAL;
+    }
+
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (MAP_FAILED == memory) {
+        LOGD("no reserved huge pages for %zu errno:%d, try transparent ones", size, errno);
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                -1, 0);
+        if (MAP_FAILED == memory) {
+            int32_t err = errno;
+            LOGE("map %zu failed errno:%d", size, err);
+            return -err;
+        }
+        // a hint, fails if transparent huge pages are off
+        madvise(memory, size, MADV_HUGEPAGE);
+    }
+    *data = memory;
+    return 0;
+#else
+    return -ENOTSUP;
+#endif
+}
+
+void unmapHugePages(void *data, std::size_t size) {
+#if defined(__linux__)
+    if (nullptr != data) {
+        munmap(data, size);
+    }
+#endif
+}
+
+}  // namespace cpfw
@@ -18,12 +18,13 @@
 namespace cpfw {
 
 uint64_t getCurrentTimeMs() {
-    struct timespec stTimeSpec;
-    clock_gettime(CLOCK_MONOTONIC, &stTimeSpec);
-    using namespace std::chrono_literals;
-    return stTimeSpec.tv_sec * std::chrono::microseconds(1s).count()
-           + stTimeSpec.tv_nsec / std::chrono::nanoseconds(1s).count();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
+uint64_t getCurrentTimeNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
 }  // namespace cpfw
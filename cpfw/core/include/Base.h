@@ -22,6 +22,9 @@
 #include <string>
 #include <vector>
 
+#include "Message.h"
+#include "SmallBundle.hpp"
+
 namespace cpfw {
 
 enum DataType : uint8_t {
@@ -61,6 +64,11 @@ const std::string KEY_WIDGET = "widget";
 const std::string KEY_ELEMENT = "element";
 const std::string KEY_VALUE = "value";
 
+constexpr BundleKey KEY_ID_WIDGET = internKey("widget");
+constexpr BundleKey KEY_ID_ELEMENT = internKey("element");
+static_assert(areKeysDistinct({ KEY_ID_WIDGET, KEY_ID_ELEMENT,
+        KEY_ID_DELAY_TIME_MS, KEY_ID_INTERVAL_NS }));
+
 }  // namespace cpfw
 
 #endif  // CPFW_CORE_INCLUDE_BASE_H_
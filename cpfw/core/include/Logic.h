@@ -17,6 +17,7 @@
 #define CPFW_CORE_INCLUDE_LOGIC_H_
 
 #include <memory>
+#include <span>
 #include <string>
 
 #include "Base.h"
@@ -39,7 +40,8 @@ class Logic {
  public:
     Logic();
 
-    Logic(const std::string &configurationFile);
+    // looper to share worker threads with other handlers, nullptr for an own thread
+    Logic(const std::string &configurationFile, std::shared_ptr<Looper> looper = nullptr);
 
     ~Logic();
 
@@ -76,13 +78,20 @@ class Logic {
  private:
     class LogicHandler : public Handler {
      public:
-        LogicHandler(Logic* logic);
+        LogicHandler(Logic* logic, std::shared_ptr<Looper> looper);
         ~LogicHandler();
 
         int32_t onInvoke(const Message &message) override;
 
+        // runs of messages for one widget invoke the chain only once
+        void onInvokeBatch(std::span<const Message> messages) override;
+
         void onReply(const Message &message, const int32_t status) override;
 
+     private:
+        // store the profile of message, return 0 and fill widgetId if success
+        int32_t applyProfile(const Message &message, uint32_t &widgetId);
+
      private:
         Logic* mLogic;
     };
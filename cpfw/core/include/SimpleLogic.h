@@ -27,7 +27,8 @@ namespace cpfw {
 class SimpleLogic {
  public:
     SimpleLogic();
-    explicit SimpleLogic(const std::string &name, std::shared_ptr<SimpleLogicHelper> helper);
+    explicit SimpleLogic(const std::string &name, std::shared_ptr<SimpleLogicHelper> helper,
+            std::shared_ptr<Looper> looper = nullptr);
     ~SimpleLogic();
 
     const std::string& getName() const;
@@ -37,7 +38,8 @@ class SimpleLogic {
  private:
     class SimpleLogicHandler : public Handler {
      public:
-        SimpleLogicHandler(SimpleLogic *SimpleLogic, std::shared_ptr<SimpleLogicHelper> helper);
+        SimpleLogicHandler(SimpleLogic *SimpleLogic, std::shared_ptr<SimpleLogicHelper> helper,
+                std::shared_ptr<Looper> looper);
         ~SimpleLogicHandler();
 
         int32_t onInvoke(const Message &message) override;
@@ -29,11 +29,11 @@ namespace cpfw {
 Logic::Logic() {
 }
 
-Logic::Logic(const std::string &configurationFile) {
+Logic::Logic(const std::string &configurationFile, std::shared_ptr<Looper> looper) {
     mStore = std::make_shared<DataStore>();
     LogicDataParser parser = LogicDataParser(configurationFile, mStore);
     mResponsibilityChain = std::make_unique<ResponsibilityChain>(mStore);
-    mHandler = std::make_unique<LogicHandler>(this);
+    mHandler = std::make_unique<LogicHandler>(this, looper);
 }
 
 Logic::~Logic() {
@@ -63,14 +63,12 @@ int32_t Logic::setProfile(const uint32_t widgetId,
         const std::vector<TElementPairWithId> &elementPairs, const PostFlag flag) {
     Message msg;
     msg.mWhat = widgetId;
-    Bundle bundle;
-    bundle.set(KEY_WIDGET, widgetId);
-    bundle.set(KEY_ELEMENT, elementPairs);
-    msg.mBundle = bundle;
+    msg.mSmallBundle.set(KEY_ID_WIDGET, widgetId);
+    msg.mSmallBundle.set(KEY_ID_ELEMENT, elementPairs);
     msg.mFlag = flag;
     msg.mArg1 = DataType::INT32;
 
-    mHandler->post(msg);
+    mHandler->post(std::move(msg));
 
     return 0;
 }
@@ -79,14 +77,12 @@ int32_t Logic::setProfile(const std::string &widgetName,
         const std::vector<TElementPairWithName> &elementPairs, const PostFlag flag) {
     Message msg;
     msg.mWhat = mStore->getIdWithStr(widgetName).value();
-    Bundle bundle;
-    bundle.set(KEY_WIDGET, widgetName);
-    bundle.set(KEY_ELEMENT, elementPairs);
-    msg.mBundle = bundle;
+    msg.mSmallBundle.set(KEY_ID_WIDGET, widgetName);
+    msg.mSmallBundle.set(KEY_ID_ELEMENT, elementPairs);
     msg.mFlag = flag;
     msg.mArg1 = DataType::STRING;
 
-    mHandler->post(msg);
+    mHandler->post(std::move(msg));
 
     return 0;
 }
@@ -96,15 +92,13 @@ int32_t Logic::setProfileDelay(const uint32_t widgetId,
         uint64_t delayTimeMs, const PostFlag flag) {
     Message msg;
     msg.mWhat = widgetId;
-    Bundle bundle;
-    bundle.set(KEY_WIDGET, widgetId);
-    bundle.set(KEY_ELEMENT, elementPairs);
-    bundle.set(KEY_DELAY_TIME_MS, delayTimeMs);
-    msg.mBundle = bundle;
+    msg.mSmallBundle.set(KEY_ID_WIDGET, widgetId);
+    msg.mSmallBundle.set(KEY_ID_ELEMENT, elementPairs);
+    msg.mSmallBundle.set(KEY_ID_DELAY_TIME_MS, delayTimeMs);
     msg.mFlag = flag;
     msg.mArg1 = DataType::INT32;
 
-    mHandler->postDelay(msg, delayTimeMs);
+    mHandler->postDelay(std::move(msg), delayTimeMs);
 
     return 0;
 }
@@ -114,15 +108,13 @@ int32_t Logic::setProfileDelay(const std::string &widgetName,
         uint64_t delayTimeMs, const PostFlag flag) {
     Message msg;
     msg.mWhat = mStore->getIdWithStr(widgetName).value();
-    Bundle bundle;
-    bundle.set(KEY_WIDGET, widgetName);
-    bundle.set(KEY_ELEMENT, elementPairs);
-    bundle.set(KEY_DELAY_TIME_MS, delayTimeMs);
-    msg.mBundle = bundle;
+    msg.mSmallBundle.set(KEY_ID_WIDGET, widgetName);
+    msg.mSmallBundle.set(KEY_ID_ELEMENT, elementPairs);
+    msg.mSmallBundle.set(KEY_ID_DELAY_TIME_MS, delayTimeMs);
     msg.mFlag = flag;
     msg.mArg1 = DataType::STRING;
 
-    mHandler->postDelay(msg, delayTimeMs);
+    mHandler->postDelay(std::move(msg), delayTimeMs);
 
     return 0;
 }
@@ -176,52 +168,83 @@ std::map<uint32_t, int32_t> Logic::getProfile(
 // get bundle with no safe version for perf, ensure it's safe inside the Logic
 void Logic::onReply(const Message &message, const int32_t status) {
     if (nullptr != mCallbackWithName && message.mArg1 == DataType::STRING) {
-        Bundle &bundle = const_cast<Message&>(message).mBundle;
+        const SmallBundle &bundle = message.mSmallBundle;
         std::string widgetName;
-        bundle.get(KEY_WIDGET, widgetName);
+        bundle.get(KEY_ID_WIDGET, widgetName);
         std::vector<TElementPairWithName> elementPairs;
-        bundle.get(KEY_ELEMENT, elementPairs);
+        bundle.get(KEY_ID_ELEMENT, elementPairs);
         mCallbackWithName(widgetName, elementPairs, status);
     } else if (nullptr != mCallbackWithId && message.mArg1 == DataType::INT32) {
-        Bundle &bundle = const_cast<Message&>(message).mBundle;
+        const SmallBundle &bundle = message.mSmallBundle;
         uint32_t widgetId = 0;
-        bundle.get(KEY_WIDGET, widgetId);
+        bundle.get(KEY_ID_WIDGET, widgetId);
         std::vector<TElementPairWithId> elementPairs;
-        bundle.get(KEY_ELEMENT, elementPairs);
+        bundle.get(KEY_ID_ELEMENT, elementPairs);
         mCallbackWithId(widgetId, elementPairs, status);
     }
 }
 
-Logic::LogicHandler::LogicHandler(Logic* logic) : mLogic(logic) {
+Logic::LogicHandler::LogicHandler(Logic* logic, std::shared_ptr<Looper> looper)
+        : Handler(looper), mLogic(logic) {
     LOGI("LogicHandler ctor");
+    setBatchMode(true);
 }
 
 Logic::LogicHandler::~LogicHandler() {
 }
 
-// get bundle with no safe version for perf, ensure it's safe inside the Logic
 int32_t Logic::LogicHandler::onInvoke(const Message &message) {
-    Bundle &bundle = const_cast<Message&>(message).mBundle;
     uint32_t widgetId = 0;
+    if (int32_t ret = applyProfile(message, widgetId); ret != 0) {
+        return ret;
+    }
+    return mLogic->mResponsibilityChain->invokeChain(widgetId);
+}
+
+void Logic::LogicHandler::onInvokeBatch(std::span<const Message> messages) {
+    std::vector<int32_t> statuses(messages.size(), 0);
+    std::size_t runBegin = 0U;
+    while (runBegin < messages.size()) {
+        // the latest profile wins, so the chain only needs to run at the end of a run
+        uint64_t what = messages[runBegin].mWhat;
+        std::size_t runEnd = runBegin;
+        uint32_t widgetId = 0;
+        bool applied = false;
+        for (; runEnd < messages.size() && messages[runEnd].mWhat == what; ++runEnd) {
+            statuses[runEnd] = applyProfile(messages[runEnd], widgetId);
+            applied |= (statuses[runEnd] == 0);
+        }
+
+        int32_t status = applied ? mLogic->mResponsibilityChain->invokeChain(widgetId) : 0;
+        for (std::size_t i=runBegin; i<runEnd; ++i) {
+            reply(messages[i], statuses[i] != 0 ? statuses[i] : status);
+        }
+        runBegin = runEnd;
+    }
+}
+
+// get bundle with no safe version for perf, ensure it's safe inside the Logic
+int32_t Logic::LogicHandler::applyProfile(const Message &message, uint32_t &widgetId) {
+    const SmallBundle &bundle = message.mSmallBundle;
 
     if (message.mArg1 == DataType::STRING) {
         std::string widgetName;
-        bundle.get(KEY_WIDGET, widgetName);
+        bundle.get(KEY_ID_WIDGET, widgetName);
         if (auto widget = mLogic->mStore->getIdWithStr(widgetName); widget) {
             widgetId = widget.value();
         } else {
             return -EINVAL;
         }
         std::vector<TElementPairWithName> elementPairs;
-        bundle.get(KEY_ELEMENT, elementPairs);
+        bundle.get(KEY_ID_ELEMENT, elementPairs);
         mLogic->mStore->setProfile(widgetName, elementPairs);
     } else if (message.mArg1 == DataType::INT32) {
-        bundle.get(KEY_WIDGET, widgetId);
+        bundle.get(KEY_ID_WIDGET, widgetId);
         std::vector<TElementPairWithId> elementPairs;
-        bundle.get(KEY_ELEMENT, elementPairs);
+        bundle.get(KEY_ID_ELEMENT, elementPairs);
         mLogic->mStore->setProfile(widgetId, elementPairs);
     }
-    return mLogic->mResponsibilityChain->invokeChain(widgetId);
+    return 0;
 }
 
 void Logic::LogicHandler::onReply(const Message &message, const int32_t status) {
@@ -24,9 +24,9 @@ namespace cpfw {
 SimpleLogic::SimpleLogic() : SimpleLogic("", nullptr) {
 }
 
-SimpleLogic::SimpleLogic(const std::string &name, std::shared_ptr<SimpleLogicHelper> helper)
-        : mName(name) {
-    mHandler = std::make_unique<SimpleLogicHandler>(this, helper);
+SimpleLogic::SimpleLogic(const std::string &name, std::shared_ptr<SimpleLogicHelper> helper,
+        std::shared_ptr<Looper> looper) : mName(name) {
+    mHandler = std::make_unique<SimpleLogicHandler>(this, helper, looper);
 }
 
 SimpleLogic::~SimpleLogic() {
@@ -37,12 +37,12 @@ const std::string& SimpleLogic::getName() const {
 }
 
 void SimpleLogic::sendMessage(Message message) {
-    mHandler->post(message);
+    mHandler->post(std::move(message));
 }
 
 SimpleLogic::SimpleLogicHandler::SimpleLogicHandler(SimpleLogic *SimpleLogic,
-        std::shared_ptr<SimpleLogicHelper> helper)
-        : mSimpleLogic(SimpleLogic), mHelper(helper) {
+        std::shared_ptr<SimpleLogicHelper> helper, std::shared_ptr<Looper> looper)
+        : Handler(looper), mSimpleLogic(SimpleLogic), mHelper(helper) {
     LOGI("SimpleLogicHandler ctor");
 }
 
@@ -0,0 +1,93 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "BundleBenchmark"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+#include "Log.hpp"
+#include "MessageQueue.h"
+
+using namespace cpfw;
+
+static std::atomic<uint64_t> gAllocCount { 0 };
+
+void* operator new(std::size_t size) {
+    ++gAllocCount;
+    if (void *p = std::malloc(size); p != nullptr) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+constexpr uint32_t ROUND = 100000;
+
+const std::string KEY_WIDGET = "widget";
+const std::string KEY_VALUE = "value";
+constexpr BundleKey KEY_ID_WIDGET = internKey("widget");
+constexpr BundleKey KEY_ID_VALUE = internKey("value");
+static_assert(areKeysDistinct({ KEY_ID_WIDGET, KEY_ID_VALUE }));
+
+// build a message the way Logic::setProfile does, queue it and take it out
+template<typename TFill>
+void benchmark(const char *name, TFill fill) {
+    auto queue = MessageQueue::create(MessageQueueType::HEAP);
+    Message msg;
+    // warm up the slab
+    fill(msg);
+    queue->push(0, std::move(msg), true);
+    queue->popFront(msg);
+
+    uint64_t allocCount = gAllocCount.load();
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i=0; i<ROUND; ++i) {
+        Message post;
+        post.mWhat = 1;
+        fill(post);
+        queue->push(i, std::move(post), true);
+        queue->popFront(msg);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double allocPerPost = static_cast<double>(gAllocCount.load() - allocCount) / ROUND;
+    double nsPerPost = std::chrono::duration<double, std::nano>(end - begin).count() / ROUND;
+    LOGI("%-12s %5.2f allocs/post  %7.1f ns/post", name, allocPerPost, nsPerPost);
+}
+
+int main() {
+    benchmark("Bundle", [](Message &msg) {
+        Bundle bundle;
+        bundle.set(KEY_WIDGET, 1U);
+        bundle.set(KEY_VALUE, 42);
+        msg.mBundle = bundle;
+    });
+
+    benchmark("SmallBundle", [](Message &msg) {
+        msg.mSmallBundle.set(KEY_ID_WIDGET, 1U);
+        msg.mSmallBundle.set(KEY_ID_VALUE, 42);
+    });
+    return 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "CoroutineTest"
+
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include "Handler.h"
+#include "Log.hpp"
+#include "ThreadPool.hpp"
+
+using namespace cpfw;
+using namespace std::chrono_literals;
+
+uint32_t getThreadId() {
+    return static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+}
+
+class UiHandler : public Handler {
+ public:
+    int32_t onInvoke(const Message &msg) override {
+        LOGI("invoke what:%lu %u", msg.mWhat, getThreadId());
+        return 0;
+    }
+
+    void onReply(const Message&, const int32_t) override {
+    }
+};
+
+// load on the pool, show on the handler, no callback and no thread blocked in between
+TaskFuture<int32_t> loadAndShow(UiHandler &ui, ThreadPool &pool) {
+    co_await ui.schedule();
+    LOGI("start on handler %u", getThreadId());
+
+    int32_t size = co_await pool.submit([] {
+        std::this_thread::sleep_for(2ms);
+        LOGI("load on worker %u", getThreadId());
+        return 42;
+    });
+    LOGI("after load %u", getThreadId());
+
+    co_await sleepFor(ui, 5ms);
+    LOGI("show %d on handler %u", size, getThreadId());
+
+    co_await pool.schedule();
+    LOGI("clean up on worker %u", getThreadId());
+    co_return size;
+}
+
+int32_t main() {
+    ThreadPool pool { 2 };
+    UiHandler ui;
+    Message msg;
+    msg.mWhat = 1U;
+    ui.post(msg);
+    auto size = loadAndShow(ui, pool);
+    msg.mWhat = 2U;
+    ui.post(msg);
+    LOGI("done %d", size.get());
+    return 0;
+}
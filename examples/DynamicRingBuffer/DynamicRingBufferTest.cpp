@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "DynamicRingBufferTest"
+
+#include <cstdint>
+#include <vector>
+
+#include "DynamicRingBuffer.hpp"
+#include "Log.hpp"
+#include "TimeUtils.h"
+
+using namespace cpfw;
+
+constexpr std::size_t CAPTURE_BYTES = 256U << 20U;
+constexpr std::size_t CHUNK = 4096U;
+
+// sweep the whole buffer once, as a capture does, return GB/s
+double capture(DynamicRingBuffer<uint8_t> &ringBuffer) {
+    std::vector<uint8_t> chunk(CHUNK, 0x5A);
+    uint64_t startNs = getCurrentTimeNs();
+    while (ringBuffer.getIdleSize() >= CHUNK) {
+        ringBuffer.write(chunk);
+    }
+    double ms = (getCurrentTimeNs() - startNs) / 1e6;
+    ringBuffer.commitRead(ringBuffer.getAvailableSize());
+    return ringBuffer.capacity() / ms / 1e6;
+}
+
+int main() {
+    // runtime capacity, rounded up to a power of 2
+    DynamicRingBuffer<int32_t> small { 10U };
+    std::vector<int32_t> in { 1, 2, 3, 4, 5, 6 };
+    std::vector<int32_t> out;
+    for (int32_t round = 0; round < 3; ++round) {
+        small.write(in);
+        small.read(out, in.size());
+        LOGI("capacity:%zu round:%d out:%d..%d available:%zu", small.capacity(), round,
+                out.front(), out.back(), small.getAvailableSize());
+    }
+    LOGI("write over capacity:%d", small.write(std::vector<int32_t>(17U)));
+
+    DynamicRingBuffer<uint8_t> heap { CAPTURE_BYTES };
+    DynamicRingBuffer<uint8_t> huge { CAPTURE_BYTES, true };
+    // the first sweep faults the pages in
+    capture(heap);
+    capture(huge);
+    LOGI("capture of %zuMB  heap:%5.2fGB/s  huge pages(%s):%5.2fGB/s", CAPTURE_BYTES >> 20U,
+            capture(heap), huge.isHugePages() ? "mapped" : "fell back to heap", capture(huge));
+    return 0;
+}
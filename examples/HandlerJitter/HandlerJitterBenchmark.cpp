@@ -0,0 +1,140 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "HandlerJitterBenchmark"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <vector>
+
+#include "Handler.h"
+#include "Log.hpp"
+#include "TimeUtils.h"
+
+using namespace cpfw;
+using namespace std::chrono_literals;
+
+constexpr uint32_t TICKS = 2000;
+constexpr uint32_t WHAT_TICK = 1;
+constexpr uint32_t WHAT_STOP = 2;
+
+/**
+ * tick TICKS times at a fixed interval, either as a LOOP message rescheduled from
+ * its last deadline, or re-posted from onInvoke with postDelay like a plain timer.
+ */
+class TickHandler : public Handler {
+ public:
+    TickHandler(std::chrono::nanoseconds interval, bool loop)
+            : mInterval(interval), mLoop(loop) {
+        mTicks.reserve(TICKS);
+    }
+
+    void start() {
+        Message msg;
+        msg.mWhat = WHAT_TICK;
+        if (mLoop) {
+            msg.mFlag = PostFlag::LOOP;
+            msg.mSmallBundle.set(KEY_ID_INTERVAL_NS, static_cast<uint64_t>(mInterval.count()));
+        }
+        mStartNs = getCurrentTimeNs() + mInterval.count();
+        postDelay(std::move(msg), mInterval);
+    }
+
+    void stop() {
+        mDone.get_future().wait();
+        Message msg;
+        msg.mWhat = WHAT_TICK;
+        msg.mFlag = PostFlag::DELETE_FORMER;
+        post(std::move(msg));
+        msg = Message();
+        msg.mWhat = WHAT_STOP;
+        post(std::move(msg));
+        mStopped.get_future().wait();
+    }
+
+    int32_t onInvoke(const Message &msg) override {
+        // the stop, the cancel posted by stop(), or a tick left after done
+        if (WHAT_TICK != msg.mWhat || 0 != (msg.mFlag & PostFlag::DELETE_FORMER)
+                || mTicks.size() >= TICKS) {
+            return 0;
+        }
+        mTicks.push_back(getCurrentTimeNs());
+        if (mTicks.size() == TICKS) {
+            mDone.set_value();
+        } else if (!mLoop) {
+            Message next;
+            next.mWhat = WHAT_TICK;
+            postDelay(std::move(next), mInterval);
+        }
+        return 0;
+    }
+
+    // the last virtual call for WHAT_STOP, so the handler can be destroyed after it
+    void onReply(const Message &msg, const int32_t) override {
+        if (WHAT_STOP == msg.mWhat) {
+            mStopped.set_value();
+        }
+    }
+
+    // late of every tick against the ideal schedule start + i * interval
+    std::vector<int64_t> getLateNs() const {
+        std::vector<int64_t> late;
+        for (std::size_t i=0; i<mTicks.size(); ++i) {
+            late.push_back(static_cast<int64_t>(mTicks[i])
+                    - static_cast<int64_t>(mStartNs + i * mInterval.count()));
+        }
+        return late;
+    }
+
+ private:
+    const std::chrono::nanoseconds mInterval;
+    const bool mLoop;
+    uint64_t mStartNs = 0U;
+    std::vector<uint64_t> mTicks;
+    std::promise<void> mDone;
+    std::promise<void> mStopped;
+};
+
+void run(const char *name, std::chrono::nanoseconds interval, bool loop) {
+    TickHandler handler(interval, loop);
+    handler.start();
+    handler.stop();
+
+    std::vector<int64_t> late = handler.getLateNs();
+    int64_t drift = late.back();
+    // jitter is the spread of the tick period, drift the accumulated late of the last tick
+    std::vector<int64_t> jitter;
+    for (std::size_t i=1; i<late.size(); ++i) {
+        jitter.push_back(std::abs(late[i] - late[i - 1]));
+    }
+    std::sort(jitter.begin(), jitter.end());
+    LOGI("%-8s interval:%6ldus  jitter p50:%6.1fus p99:%7.1fus max:%7.1fus  drift:%9.1fus",
+            name, static_cast<long>(interval.count() / 1000),
+            jitter[jitter.size() / 2] / 1000.0,
+            jitter[jitter.size() * 99 / 100] / 1000.0,
+            jitter.back() / 1000.0, drift / 1000.0);
+}
+
+int main() {
+    for (auto interval : { std::chrono::nanoseconds(1ms), std::chrono::nanoseconds(250us),
+            std::chrono::nanoseconds(100us) }) {
+        run("relative", interval, false);
+        run("loop", interval, true);
+    }
+    return 0;
+}
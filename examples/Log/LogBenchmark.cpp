@@ -0,0 +1,95 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "LogBenchmark"
+
+#include <chrono>
+#include <cstdio>
+#include <future>
+
+#include "Handler.h"
+#include "Log.hpp"
+
+using namespace cpfw;
+
+constexpr uint32_t COUNT = 200000;
+
+// logs on every post and every invoke, like a chatty handler
+class LogHandler : public Handler {
+ public:
+    std::future<void> getDone() {
+        return mDone.get_future();
+    }
+
+    int32_t onInvoke(const Message &msg) override {
+        LOGI("onInvoke what:%lu arg1:%d name:%s", msg.mWhat, msg.mArg1, "tick");
+        return 0;
+    }
+
+    // the last virtual call for a message, so the handler can be destroyed after it
+    void onReply(const Message &msg, const int32_t) override {
+        if (msg.mArg1 == COUNT - 1) {
+            mDone.set_value();
+        }
+    }
+
+ private:
+    std::promise<void> mDone;
+};
+
+// cost on the calling thread only
+double benchmarkLogCall() {
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i=0; i<COUNT; ++i) {
+        LOGI("log what:%u arg1:%d name:%s", i % 16, i, "tick");
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count() / COUNT;
+}
+
+int main() {
+    double logNs = benchmarkLogCall();
+
+    LogHandler handler;
+    std::future<void> done = handler.getDone();
+
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i=0; i<COUNT; ++i) {
+        Message msg;
+        msg.mWhat = i % 16;
+        msg.mArg1 = i;
+        LOGI("post what:%lu arg1:%d", msg.mWhat, msg.mArg1);
+        handler.post(std::move(msg));
+    }
+    auto posted = std::chrono::steady_clock::now();
+    done.wait();
+    auto end = std::chrono::steady_clock::now();
+
+    // on stderr, run it with stdout to /dev/null to leave the logs out
+#if CPFW_LOG_LEVEL == CPFW_LOG_LEVEL_NONE
+    const char *mode = "off";
+#elif defined(CPFW_LOG_ASYNC)
+    const char *mode = "async";
+#else
+    const char *mode = "sync";
+#endif
+    double postNs = std::chrono::duration<double, std::nano>(posted - begin).count() / COUNT;
+    double totalS = std::chrono::duration<double>(end - begin).count();
+    fprintf(stderr, "%-6s log:%7.1f ns/call  post:%8.1f ns/msg  throughput:%10.0f msg/s\n",
+            mode, logNs, postNs, COUNT / totalS);
+    return 0;
+}
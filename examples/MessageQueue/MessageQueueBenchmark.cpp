@@ -0,0 +1,92 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MessageQueueBenchmark"
+
+#include <chrono>
+#include <random>
+
+#include "Log.hpp"
+#include "MessageQueue.h"
+
+using namespace cpfw;
+
+constexpr uint32_t ROUND = 10;
+constexpr uint32_t DEPTH = 10000;
+
+// keep DEPTH messages queued, then push one and pop one per step
+template<typename TWhen>
+double benchmark(MessageQueueType type, TWhen nextWhenNs, bool due) {
+    auto queue = MessageQueue::create(type);
+    Message msg;
+    msg.mWhat = 0;
+    for (uint32_t i=0; i<DEPTH; ++i) {
+        msg.mWhat = i % 16;
+        queue->push(nextWhenNs(), Message(msg), due);
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i=0; i<ROUND*DEPTH; ++i) {
+        msg.mWhat = i % 16;
+        queue->push(nextWhenNs(), Message(msg), due);
+        queue->popFront(msg);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count() / (ROUND*DEPTH);
+}
+
+// keep DEPTH delayed messages of WHAT_COUNT whats queued, then replace one what per step
+// like a DELETE_FORMER post
+double benchmarkReplace(MessageQueueType type) {
+    constexpr uint32_t WHAT_COUNT = 1000;
+    auto queue = MessageQueue::create(type);
+    std::mt19937_64 engine(42);
+    std::uniform_int_distribution<uint64_t> distribution(0, 1000000);
+    Message msg;
+    for (uint32_t i=0; i<DEPTH; ++i) {
+        msg.mWhat = i % WHAT_COUNT;
+        queue->push(distribution(engine), Message(msg), false);
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i=0; i<ROUND*DEPTH; ++i) {
+        msg.mWhat = i % WHAT_COUNT;
+        queue->erase(msg.mWhat);
+        queue->push(distribution(engine), Message(msg), false);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count() / (ROUND*DEPTH);
+}
+
+void run(const char *name, MessageQueueType type) {
+    uint64_t whenNs = 0;
+    double immediate = benchmark(type, [&whenNs]() { return whenNs++; }, true);
+
+    std::mt19937_64 engine(42);
+    std::uniform_int_distribution<uint64_t> distribution(0, 1000000);
+    double delayed = benchmark(type, [&]() { return distribution(engine); }, false);
+
+    double replace = benchmarkReplace(type);
+
+    LOGI("%-9s immediate:%8.1f ns/op  delayed:%8.1f ns/op  replace:%8.1f ns/op",
+            name, immediate, delayed, replace);
+}
+
+int main() {
+    run("multimap", MessageQueueType::MULTIMAP);
+    run("heap", MessageQueueType::HEAP);
+    return 0;
+}
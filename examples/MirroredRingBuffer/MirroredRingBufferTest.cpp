@@ -0,0 +1,91 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "MirroredRingBufferTest"
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include <unistd.h>
+
+#include "Log.hpp"
+#include "MirroredRingBuffer.hpp"
+#include "RingBuffer.hpp"
+#include "TimeUtils.h"
+
+using namespace cpfw;
+
+constexpr int32_t N = 1 << 20;
+constexpr std::size_t CHUNK = 3000U;  // not a divisor of N, so chunks wrap around
+constexpr std::size_t ROUNDS = 200000U;
+
+// a chunk through a pipe, read() lands straight in the buffer across its end
+void pipeThrough(MirroredRingBuffer<char> &ringBuffer) {
+    int32_t fds[2];
+    if (0 != pipe(fds)) {
+        return;
+    }
+    std::vector<char> in(CHUNK);
+    std::iota(in.begin(), in.end(), 0);
+    ssize_t written = ::write(fds[1], in.data(), in.size());
+
+    ringBuffer.commitWrite(ringBuffer.capacity() - CHUNK / 2U);
+    ringBuffer.commitRead(ringBuffer.capacity() - CHUNK / 2U);
+    std::span<char> idle = ringBuffer.acquireWrite(CHUNK);
+    ssize_t got = ::read(fds[0], idle.data(), idle.size_bytes());
+    ringBuffer.commitWrite(got > 0 ? got : 0);
+    LOGI("pipe wrote:%zd read:%zd into one span across the end, match:%d", written, got,
+            std::equal(in.begin(), in.end(), ringBuffer.acquireRead(CHUNK).begin()));
+    ringBuffer.commitRead(ringBuffer.getAvailableSize());
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main() {
+    MirroredRingBuffer<char> mirrored { N };
+    if (!mirrored.valid()) {
+        LOGE("no mirrored memory");
+        return 1;
+    }
+    LOGI("capacity:%zu", mirrored.capacity());
+    pipeThrough(mirrored);
+
+    std::vector<char> in(CHUNK, 'x');
+    std::vector<char> out(CHUNK);
+
+    auto ringBuffer = std::make_unique<RingBuffer<char, N>>();
+    uint64_t startNs = getCurrentTimeNs();
+    for (std::size_t i=0; i<ROUNDS; ++i) {
+        ringBuffer->write(std::span<const char>(in));
+        ringBuffer->read(std::span<char>(out));
+    }
+    double ringMs = (getCurrentTimeNs() - startNs) / 1e6;
+
+    startNs = getCurrentTimeNs();
+    for (std::size_t i=0; i<ROUNDS; ++i) {
+        mirrored.write(std::span<const char>(in));
+        mirrored.read(std::span<char>(out));
+    }
+    double mirroredMs = (getCurrentTimeNs() - startNs) / 1e6;
+
+    double gb = static_cast<double>(CHUNK) * ROUNDS * 2.0 / 1e9;
+    LOGI("chunks:%zu of %zu bytes  RingBuffer:%7.1fms %5.2fGB/s  mirrored:%7.1fms %5.2fGB/s",
+            ROUNDS, CHUNK, ringMs, gb / ringMs * 1e3, mirroredMs, gb / mirroredMs * 1e3);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "MpmcQueueBenchmark"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Log.hpp"
+#include "MpmcQueue.hpp"
+#include "RingBuffer.hpp"
+#include "TimeUtils.h"
+
+using namespace cpfw;
+
+constexpr int32_t CAPACITY = 1024;
+constexpr uint64_t ITEMS = 400000U;
+using T = uint64_t;
+
+/**
+ * RingBuffer under one lock and a condition variable, blocking both ways, as the baseline.
+ * RingBufferManager itself writes without its lock while there is room, so it is not safe
+ * with several producers.
+ */
+class LockedRingBuffer {
+ public:
+    void push(T value) {
+        thread_local std::vector<T> writeBuffer(1U);
+        writeBuffer[0] = value;
+        std::unique_lock<std::mutex> lock { mLock };
+        mCv.wait(lock, [this] {
+            return mBuffer.getIdleSize() > 0;
+        });
+        mBuffer.write(writeBuffer);
+        mCv.notify_all();
+    }
+
+    void pop(T &value) {
+        thread_local std::vector<T> readBuffer(1U);
+        std::unique_lock<std::mutex> lock { mLock };
+        mCv.wait(lock, [this] {
+            return mBuffer.getAvailableSize() > 0;
+        });
+        mBuffer.read(readBuffer, 1U);
+        mCv.notify_all();
+        value = readBuffer[0];
+    }
+
+ private:
+    std::mutex mLock;
+    std::condition_variable mCv;
+    RingBuffer<T, CAPACITY> mBuffer;
+};
+
+// threads producers push ITEMS in all, as many consumers pop them, return ms
+template<class QUEUE>
+double run(QUEUE &queue, uint32_t threads) {
+    uint64_t startNs = getCurrentTimeNs();
+    std::vector<std::thread> producers;
+    std::vector<std::thread> consumers;
+    std::vector<uint64_t> sums(threads, 0U);
+    for (uint32_t t=0; t<threads; ++t) {
+        producers.emplace_back([&queue, threads, t] {
+            for (uint64_t i=t; i<ITEMS; i+=threads) {
+                queue.push(i);
+            }
+        });
+        consumers.emplace_back([&queue, &sums, threads, t] {
+            uint64_t count = ITEMS / threads + (t < ITEMS % threads ? 1U : 0U);
+            T value = 0U;
+            for (uint64_t i=0; i<count; ++i) {
+                queue.pop(value);
+                sums[t] += value;
+            }
+        });
+    }
+    for (auto &thread : producers) {
+        thread.join();
+    }
+    for (auto &thread : consumers) {
+        thread.join();
+    }
+    double ms = (getCurrentTimeNs() - startNs) / 1e6;
+
+    uint64_t sum = 0U;
+    for (uint64_t value : sums) {
+        sum += value;
+    }
+    if (sum != ITEMS * (ITEMS - 1U) / 2U) {
+        LOGE("lost items, sum %lu", sum);
+    }
+    return ms;
+}
+
+int main() {
+    for (uint32_t threads : { 1U, 2U, 4U, 8U }) {
+        LockedRingBuffer locked;
+        double lockedMs = run(locked, threads);
+        MpmcQueue<T> mpmc { CAPACITY };
+        double mpmcMs = run(mpmc, threads);
+        LOGI("producers/consumers:%u  items:%lu  locked:%7.1fms %5.2fM/s  mpmc:%7.1fms %5.2fM/s",
+                threads, ITEMS, lockedMs, ITEMS / lockedMs / 1e3, mpmcMs, ITEMS / mpmcMs / 1e3);
+    }
+    return 0;
+}
@@ -77,6 +77,34 @@ int main() {
     test(ringBuffer, {'d', 'e', 'f'}, 4);
     test(ringBuffer, {'g', 'h', 'i'}, 4);
 
+    // fill and consume in place, the ranges wrap around the end
+    std::cout << "in place:" << std::endl;
+    auto writeSpans = ringBuffer.acquireWrite(7);
+    char c = 'j';
+    for (auto part : { writeSpans.first, writeSpans.second }) {
+        for (T &slot : part) {
+            slot = c++;
+        }
+    }
+    ringBuffer.commitWrite(writeSpans.size());
+    print("rb: ", ringBuffer);
+    auto readSpans = ringBuffer.acquireRead(7);
+    std::vector<T> out(readSpans.first.begin(), readSpans.first.end());
+    out.insert(out.end(), readSpans.second.begin(), readSpans.second.end());
+    ringBuffer.commitRead(readSpans.size());
+    print("ou: ", out);
+
+    // lossy, the oldest are dropped to make room
+    std::cout << "overwrite oldest:" << std::endl;
+    ringBuffer.setOverwriteOldest(true);
+    ringBuffer.write(std::vector<T> {'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y'});
+    ringBuffer.write(std::vector<T> {'z', 'A', 'B', 'C', 'D', 'E'});
+    print("rb: ", ringBuffer);
+    std::vector<T> lossy;
+    ringBuffer.read(lossy, ringBuffer.getAvailableSize());
+    print("ou: ", lossy);
+    LOGD("dropped:%lu", ringBuffer.getDroppedCount());
+
     return 0;
 }
 
@@ -0,0 +1,127 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "SpscRingBufferBenchmark"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Log.hpp"
+#include "RingBuffer.hpp"
+#include "SpscRingBuffer.hpp"
+#include "TimeUtils.h"
+
+using namespace cpfw;
+
+constexpr int32_t N = 4096;
+constexpr std::size_t CHUNK = 64U;
+constexpr std::size_t CHUNKS = 200000U;
+using T = float;
+
+/**
+ * RingBuffer under a lock and a condition variable as RingBufferManager does,
+ * blocking both ways, as the baseline.
+ */
+class LockedRingBuffer {
+ public:
+    void write(const std::vector<T> &writeBuffer) {
+        std::unique_lock<std::mutex> lock { mLock };
+        mCv.wait(lock, [&] {
+            return static_cast<std::size_t>(mBuffer.getIdleSize()) >= writeBuffer.size();
+        });
+        mBuffer.write(writeBuffer);
+        mCv.notify_all();
+    }
+
+    void read(std::vector<T> &readBuffer, std::size_t readSize) {
+        std::unique_lock<std::mutex> lock { mLock };
+        mCv.wait(lock, [&] {
+            return static_cast<std::size_t>(mBuffer.getAvailableSize()) >= readSize;
+        });
+        mBuffer.read(readBuffer, readSize);
+        mCv.notify_all();
+    }
+
+ private:
+    std::mutex mLock;
+    std::condition_variable mCv;
+    RingBuffer<T, N> mBuffer;
+};
+
+// -EAGAIN means the other side is behind, give it the cpu
+class SpinningRingBuffer {
+ public:
+    void write(const std::vector<T> &writeBuffer) {
+        while (0 != mBuffer.write(writeBuffer)) {
+            std::this_thread::yield();
+        }
+    }
+
+    void read(std::vector<T> &readBuffer, std::size_t readSize) {
+        while (0 != mBuffer.read(readBuffer, readSize)) {
+            std::this_thread::yield();
+        }
+    }
+
+ private:
+    SpscRingBuffer<T, N> mBuffer;
+};
+
+// one producer and one consumer, return ms, the sum read back is checked
+template<class BUFFER>
+double stream(BUFFER &buffer) {
+    uint64_t startNs = getCurrentTimeNs();
+    std::thread producer([&buffer] {
+        std::vector<T> chunk(CHUNK);
+        for (std::size_t i=0; i<CHUNKS; ++i) {
+            chunk[0] = static_cast<T>(i & 0xFFU);
+            buffer.write(chunk);
+        }
+    });
+
+    std::vector<T> chunk;
+    uint64_t sum = 0U;
+    for (std::size_t i=0; i<CHUNKS; ++i) {
+        buffer.read(chunk, CHUNK);
+        sum += static_cast<uint64_t>(chunk[0]);
+    }
+    producer.join();
+    double ms = (getCurrentTimeNs() - startNs) / 1e6;
+
+    uint64_t expected = 0U;
+    for (std::size_t i=0; i<CHUNKS; ++i) {
+        expected += i & 0xFFU;
+    }
+    if (sum != expected) {
+        LOGE("sum %lu != %lu", sum, expected);
+    }
+    return ms;
+}
+
+int main() {
+    LockedRingBuffer locked;
+    double lockedMs = stream(locked);
+    SpinningRingBuffer spsc;
+    double spscMs = stream(spsc);
+
+    double elements = static_cast<double>(CHUNK) * CHUNKS;
+    LOGI("chunks:%zu of %zu  locked:%7.1fms %6.1fM elements/s  spsc:%7.1fms %6.1fM elements/s",
+            CHUNKS, CHUNK, lockedMs, elements / lockedMs / 1e3, spscMs, elements / spscMs / 1e3);
+    return 0;
+}
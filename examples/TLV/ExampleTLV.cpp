@@ -49,7 +49,7 @@ int main() {
 
     TTag *t = tlv.getTag();
 
-    LOGI("test header valueSize and value")
+    LOGI("test header valueSize and value");
     LOGI("tlv before setValue size:%ld", tlv.getTotalSize());
     LOGI("tlv ref tag:cmd:%d", t->cmd);
     LOGI("tlv ref tag:type:%d", t->type);
@@ -75,7 +75,7 @@ int main() {
     LOGI("tlv ref value:param2:%d", ret->param2);
     LOGI("tlv ref value:param3:%d", ret->param3);
 
-    LOGI("\ntest header")
+    LOGI("\ntest header");
     TLV<TTag, uint8_t> tlv1(&tag);
     t = tlv1.getTag();
     t->cmd = 123;
@@ -110,7 +110,7 @@ int main() {
         LOGI("tlv1 ref value size fault");
     }
 
-    LOGI("\ntest serialize to and from constract")
+    LOGI("\ntest serialize to and from constract");
     std::vector<uint8_t> buf = requestBuffer(tlv1.getTotalSize());
     tlv1.serializeTo(&buf[0], buf.capacity());
     TLV<TTag, uint8_t> tlv2(reinterpret_cast<uint8_t*>(&buf[0]), buf.capacity());
@@ -130,7 +130,7 @@ int main() {
         LOGI("tlv2 ref value size fault");
     }
 
-    LOGI("\ntest serialize to and from func")
+    LOGI("\ntest serialize to and from func");
     TLV<TTag, uint8_t> tlv3(tlv2.getTotalSize());
     tlv3.unserializeFrom(reinterpret_cast<uint8_t*>(&buf[0]), buf.size());
     LOGI("tlv3 ref tag:cmd:%d", t->cmd);
@@ -111,6 +111,50 @@ int32_t main() {
         tmp.append(" ");
     }
     LOGI("%s", tmp.c_str());
+
+    // a DAG: two sources, joined, then a step on the join, no thread blocks in between
+    auto left = pool.submit([] { return 6; }).then([](int32_t n) { return n * 10; });
+    auto right = pool.submit([] { return 7; });
+    auto sum = whenAll(std::move(left), std::move(right)).then(
+        [](std::tuple<TaskFuture<int32_t>, TaskFuture<int32_t>> results) {
+            return std::get<0>(results).get() + std::get<1>(results).get();
+        });
+    LOGI(" =======  dag ========= %d", sum.get());
+
+    // a join whose input never completes, dropping it frees the join and its inputs
+    std::weak_ptr<TaskState<int32_t>> never;
+    {
+        auto ready = makeTaskState<int32_t>(&pool);
+        ready->setValue(1);
+        auto pending = makeTaskState<int32_t>(&pool);
+        never = pending;
+        std::vector<TaskFuture<int32_t>> inputs;
+        inputs.emplace_back(std::move(ready));
+        inputs.emplace_back(std::move(pending));
+        auto join = whenAll(std::move(inputs));
+    }
+    if (!never.expired()) {
+        LOGE(" =======  incomplete join leaked");
+        return 1;
+    }
+    LOGI(" =======  incomplete join freed");
+
+    // elastic: 2 threads, more while a burst of blocking tasks waits, back to 2 when idle
+    ThreadPool::Config config;
+    config.threadCount = 2U;
+    config.maxThreadCount = 8U;
+    config.idleTimeout = std::chrono::milliseconds(200);
+    cpfw::ThreadPool elastic { config };
+    std::vector<std::future<void>> burst;
+    for (int32_t i = 0; i < 32; ++i) {
+        burst.push_back(elastic.commit(fun1, 10));
+    }
+    for (auto &done : burst) {
+        done.get();
+    }
+    LOGI(" =======  elastic after burst threads:%u", elastic.getThreadCount());
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    LOGI(" =======  elastic after idle threads:%u", elastic.getThreadCount());
     return 0;
 }
 
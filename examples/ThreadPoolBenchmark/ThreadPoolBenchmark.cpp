@@ -0,0 +1,204 @@
+/**
+ * Copyright (C) 2022 The Cross Platform Framework Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "ThreadPoolBenchmark"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "Log.hpp"
+#include "ThreadPool.hpp"
+#include "TimeUtils.h"
+
+using namespace cpfw;
+
+constexpr uint32_t THREADS = 4U;
+constexpr uint32_t FLAT_TASKS = 200000U;
+constexpr uint32_t TREE_DEPTH = 17U;  // 2^17 leaves
+constexpr uint32_t BATCH_SIZE = 1000U;
+
+/**
+ * the former pool, one queue under one lock shared by all workers, as the baseline.
+ * commit the same way, so both pay for the future.
+ */
+class LockedQueuePool {
+ public:
+    explicit LockedQueuePool(uint32_t size) {
+        for (uint32_t i=0; i<size; ++i) {
+            mThreads.emplace_back([this] {
+                while (true) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock { mLock };
+                        mCv.wait(lock, [this] { return !mIsRunning || !mTasks.empty(); });
+                        if (!mIsRunning && mTasks.empty()) {
+                            return;
+                        }
+                        task = std::move(mTasks.front());
+                        mTasks.pop();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+
+    ~LockedQueuePool() {
+        {
+            std::lock_guard<std::mutex> lock { mLock };
+            mIsRunning = false;
+        }
+        mCv.notify_all();
+        for (auto &thread : mThreads) {
+            thread.join();
+        }
+    }
+
+    template<class F>
+    std::future<void> commit(F &&f) {
+        auto task = std::make_shared<std::packaged_task<void()>>(std::forward<F>(f));
+        std::future<void> future = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock { mLock };
+            mTasks.emplace([task]() {
+                (*task)();
+            });
+        }
+        mCv.notify_one();
+        return future;
+    }
+
+ private:
+    std::vector<std::thread> mThreads;
+    std::queue<std::function<void()>> mTasks;
+    std::mutex mLock;
+    std::condition_variable mCv;
+    bool mIsRunning = true;
+};
+
+void waitZero(const std::atomic<uint32_t> &remaining) {
+    while (remaining.load(std::memory_order_acquire) > 0U) {
+        std::this_thread::yield();
+    }
+}
+
+// futures of commit are dropped, post has none
+template<bool POST, class POOL, class F>
+void submit(POOL &pool, F &&f) {
+    if constexpr (POST) {
+        pool.post(std::forward<F>(f));
+    } else {
+        pool.commit(std::forward<F>(f));
+    }
+}
+
+// many tiny tasks submitted from outside of the pool
+template<bool POST, class POOL>
+double flat(POOL &pool) {
+    std::atomic<uint32_t> remaining { FLAT_TASKS };
+    uint64_t startNs = getCurrentTimeNs();
+    for (uint32_t i=0; i<FLAT_TASKS; ++i) {
+        submit<POST>(pool, [&remaining] {
+            remaining.fetch_sub(1U, std::memory_order_release);
+        });
+    }
+    waitZero(remaining);
+    return (getCurrentTimeNs() - startNs) / 1e6;
+}
+
+// as flat<true>, BATCH_SIZE tasks a lock and a wake up
+double flatBatch(ThreadPool &pool) {
+    std::atomic<uint32_t> remaining { FLAT_TASKS };
+    std::vector<std::function<void()>> batch(BATCH_SIZE, [&remaining] {
+        remaining.fetch_sub(1U, std::memory_order_release);
+    });
+    uint64_t startNs = getCurrentTimeNs();
+    for (uint32_t i=0; i<FLAT_TASKS; i+=BATCH_SIZE) {
+        pool.postBatch(batch);
+    }
+    waitZero(remaining);
+    return (getCurrentTimeNs() - startNs) / 1e6;
+}
+
+// every task forks 2 until the leaves, tasks are submitted from the workers
+template<bool POST, class POOL>
+void fork(POOL &pool, uint32_t depth, std::atomic<uint32_t> &remaining) {
+    if (0U == depth) {
+        remaining.fetch_sub(1U, std::memory_order_release);
+        return;
+    }
+    for (int32_t i=0; i<2; ++i) {
+        submit<POST>(pool, [&pool, depth, &remaining] {
+            fork<POST>(pool, depth - 1, remaining);
+        });
+    }
+}
+
+template<bool POST, class POOL>
+double tree(POOL &pool) {
+    std::atomic<uint32_t> remaining { 1U << TREE_DEPTH };
+    uint64_t startNs = getCurrentTimeNs();
+    submit<POST>(pool, [&pool, &remaining] {
+        fork<POST>(pool, TREE_DEPTH, remaining);
+    });
+    waitZero(remaining);
+    return (getCurrentTimeNs() - startNs) / 1e6;
+}
+
+void report(const char *name, uint32_t tasks, double lockedMs, double commitMs, double postMs) {
+    LOGI("%-5s tasks:%7u  locked queue commit:%7.1fms %5.2fM/s  work stealing commit:%7.1fms "
+            "%5.2fM/s  post:%7.1fms %5.2fM/s", name, tasks, lockedMs, tasks / lockedMs / 1e3,
+            commitMs, tasks / commitMs / 1e3, postMs, tasks / postMs / 1e3);
+}
+
+int main() {
+    double lockedFlat = 0.0;
+    double lockedTree = 0.0;
+    {
+        LockedQueuePool pool { THREADS };
+        lockedFlat = flat<false>(pool);
+        lockedTree = tree<false>(pool);
+    }
+
+    double commitFlat = 0.0;
+    double commitTree = 0.0;
+    double postFlat = 0.0;
+    double postTree = 0.0;
+    double batchFlat = 0.0;
+    {
+        ThreadPool pool { THREADS };
+        commitFlat = flat<false>(pool);
+        commitTree = tree<false>(pool);
+        postFlat = flat<true>(pool);
+        postTree = tree<true>(pool);
+        batchFlat = flatBatch(pool);
+    }
+
+    report("flat", FLAT_TASKS, lockedFlat, commitFlat, postFlat);
+    // internal nodes are tasks too
+    report("tree", (2U << TREE_DEPTH) - 1U, lockedTree, commitTree, postTree);
+    LOGI("batch tasks:%7u  postBatch of %u:%7.1fms %5.2fM/s", FLAT_TASKS, BATCH_SIZE,
+            batchFlat, FLAT_TASKS / batchFlat / 1e3);
+    return 0;
+}